@@ -0,0 +1,123 @@
+#pragma  once
+
+#include <algorithm>
+#include <cmath>
+
+namespace NeNet
+{
+
+/*
+ * Activation, softmax, loss and dense layer kernels on plain arrays. Used by NeuralNetwork
+ * and by all evaluators of flat weights (in order of NeuralNetwork::getEdges()),
+ * so that all of them compute bitwise identical values.
+ */
+
+inline double sigmoid(const double x)
+{
+    return 1.0 / (1.0 + std::exp(-1.0 * x));
+}
+
+/**
+ * Replaces weighted sums of output layer by softmax (shifted by the maximum, so exp cannot overflow).
+ */
+inline void softmax(double* values, const int size)
+{
+    double maxValue = values[0];
+    for (int i = 0; i < size; i++)
+    {
+        maxValue = std::max(maxValue, values[i]);
+    }
+    double sum = 0;
+    for (int i = 0; i < size; i++)
+    {
+        values[i] = std::exp(values[i] - maxValue);
+        sum += values[i];
+    }
+    for (int i = 0; i < size; i++)
+    {
+        values[i] = values[i] / sum;
+    }
+}
+
+/**
+ * Cross-entropy loss computed from weighted sums of output layer, stable for large sums.
+ * With more outputs it is loss of softmax and sample output is the class index,
+ * with one output it is binary cross-entropy of sigmoid and sample output is 0 or 1.
+ */
+inline double crossEntropyLoss(const double* weightedSums, const int size, const double sampleOutput)
+{
+    if (size > 1)
+    {
+        /* -log(softmax) = logSumExp(weighted sums) - weighted sum of expected class */
+        double maxWeightedSum = weightedSums[0];
+        for (int i = 0; i < size; i++)
+        {
+            maxWeightedSum = std::max(maxWeightedSum, weightedSums[i]);
+        }
+        double sum = 0;
+        for (int i = 0; i < size; i++)
+        {
+            sum += std::exp(weightedSums[i] - maxWeightedSum);
+        }
+        return maxWeightedSum + std::log(sum) - weightedSums[(int)sampleOutput];
+    }
+    
+    /* Binary cross-entropy expressed by logit z */
+    const double z = weightedSums[0];
+    return std::max(z, 0.0) - z * sampleOutput + std::log1p(std::exp(-std::fabs(z)));
+}
+
+/**
+ * Weighted sums of one dense layer for one pattern. Weights of the layer are ordered
+ * by origin (bias first), then by destination; summation order is the same
+ * as in Perceptron::processInputs.
+ */
+inline void computeWeightedSums(const double* weights, const double* inputs,
+                                const int numOfLayerInputs, const int layerSize, double* sums)
+{
+    for (int to = 0; to < layerSize; to++)
+    {
+        sums[to] = 0;
+        sums[to] += 1.0 * weights[to];
+    }
+    for (int from = 0; from < numOfLayerInputs; from++)
+    {
+        const double value = inputs[from];
+        const double* edgeWeights = weights + (from + 1) * layerSize;
+        for (int to = 0; to < layerSize; to++)
+        {
+            sums[to] += value * edgeWeights[to];
+        }
+    }
+}
+
+/**
+ * Replaces weighted sums of a layer by its outputs, softmax is used for output layer only.
+ */
+inline void activate(double* values, const int size, const bool isSoftmax)
+{
+    if (isSoftmax)
+    {
+        softmax(values, size);
+    }
+    else
+    {
+        for (int i = 0; i < size; i++)
+        {
+            values[i] = sigmoid(values[i]);
+        }
+    }
+}
+
+/**
+ * Outputs of one dense layer for one pattern.
+ */
+inline void computeLayerOutputs(const double* weights, const double* inputs,
+                                const int numOfLayerInputs, const int layerSize,
+                                const bool isSoftmax, double* outputs)
+{
+    computeWeightedSums(weights, inputs, numOfLayerInputs, layerSize, outputs);
+    activate(outputs, layerSize, isSoftmax);
+}
+
+}
@@ -0,0 +1,360 @@
+#include "AllreduceTransport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace NeNet
+{
+
+bool ringAllreduce(AllreduceTransport& transport, double* data, const size_t count)
+{
+    const int n = transport.getNumOfWorkers();
+    const int rank = transport.getRank();
+    if (n == 1)
+    {
+        return true;
+    }
+    
+    auto begin = [count, n](int chunk) { return count * chunk / n; };
+    auto size = [&begin](int chunk) { return begin(chunk + 1) - begin(chunk); };
+    
+    /* Reduce-scatter: after n - 1 steps worker r holds complete sum of chunk (r + 1) % n */
+    vector<double> buffer(size(0) + 1);
+    for (int step = 0; step < n - 1; step++)
+    {
+        const int sendChunk = (rank - step + n) % n;
+        const int receiveChunk = (rank - step - 1 + n) % n;
+        buffer.resize(size(receiveChunk));
+        if (!transport.sendReceive(data + begin(sendChunk), size(sendChunk), buffer.data(), buffer.size()))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < buffer.size(); i++)
+        {
+            data[begin(receiveChunk) + i] += buffer[i];
+        }
+    }
+    
+    /* Allgather: complete chunks travel around the ring */
+    for (int step = 0; step < n - 1; step++)
+    {
+        const int sendChunk = (rank - step + 1 + n) % n;
+        const int receiveChunk = (rank - step + n) % n;
+        if (!transport.sendReceive(data + begin(sendChunk), size(sendChunk),
+                                   data + begin(receiveChunk), size(receiveChunk)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ---------- Shared memory ---------- */
+
+static const size_t CHANNEL_CAPACITY = 1 << 16; // in doubles, power of 2
+
+struct SharedMemoryTransport::Channel
+{
+    alignas(64) atomic<uint64_t> head; // total number of doubles read
+    alignas(64) atomic<uint64_t> tail; // total number of doubles written
+    alignas(64) double data[CHANNEL_CAPACITY];
+};
+
+size_t SharedMemoryTransport::getSegmentSize(const int numOfWorkers)
+{
+    return sizeof(SharedMemoryTransport::Channel) * numOfWorkers;
+}
+
+bool SharedMemoryTransport::create(const string& name, const int numOfWorkers)
+{
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    
+    /* New segment is zero-filled, i.e. all channels are empty */
+    const bool isResized = ftruncate(fd, getSegmentSize(numOfWorkers)) == 0;
+    close(fd);
+    return isResized;
+}
+
+void SharedMemoryTransport::unlink(const string& name)
+{
+    shm_unlink(name.c_str());
+}
+
+SharedMemoryTransport::SharedMemoryTransport(const string& name, const int rank, const int numOfWorkers,
+                                             const chrono::milliseconds timeout) :
+    _name(name),
+    _rank(rank),
+    _numOfWorkers(numOfWorkers),
+    _timeout(timeout),
+    _segment(nullptr),
+    _segmentSize(getSegmentSize(numOfWorkers))
+{
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+    {
+        cerr << "Opening shared memory " << name << " failed" << endl;
+        return;
+    }
+    
+    void* segment = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        cerr << "Mapping shared memory " << name << " failed" << endl;
+        return;
+    }
+    _segment = segment;
+}
+
+SharedMemoryTransport::~SharedMemoryTransport()
+{
+    if (_segment)
+    {
+        munmap(_segment, _segmentSize);
+    }
+}
+
+SharedMemoryTransport::Channel* SharedMemoryTransport::getChannel(const int from)
+{
+    return static_cast<Channel*>(_segment) + from;
+}
+
+bool SharedMemoryTransport::sendReceive(const double* sendData, const size_t sendCount,
+                                        double* receiveData, const size_t receiveCount)
+{
+    Channel* out = getChannel(_rank);
+    Channel* in = getChannel((_rank - 1 + _numOfWorkers) % _numOfWorkers);
+    
+    /* Alternating non-blocking writes and reads, so that messages longer
+     * than capacity of the channel cannot deadlock the ring */
+    size_t sent = 0;
+    size_t received = 0;
+    chrono::steady_clock::time_point lastProgress = chrono::steady_clock::now();
+    while (sent < sendCount || received < receiveCount)
+    {
+        bool hasProgressed = false;
+        
+        if (sent < sendCount)
+        {
+            const uint64_t tail = out->tail.load(memory_order_relaxed);
+            const uint64_t head = out->head.load(memory_order_acquire);
+            const size_t numToWrite = min((size_t)(CHANNEL_CAPACITY - (tail - head)), sendCount - sent);
+            for (size_t i = 0; i < numToWrite; i++)
+            {
+                out->data[(tail + i) % CHANNEL_CAPACITY] = sendData[sent + i];
+            }
+            out->tail.store(tail + numToWrite, memory_order_release);
+            sent += numToWrite;
+            hasProgressed |= numToWrite > 0;
+        }
+        
+        if (received < receiveCount)
+        {
+            const uint64_t head = in->head.load(memory_order_relaxed);
+            const uint64_t tail = in->tail.load(memory_order_acquire);
+            const size_t numToRead = min((size_t)(tail - head), receiveCount - received);
+            for (size_t i = 0; i < numToRead; i++)
+            {
+                receiveData[received + i] = in->data[(head + i) % CHANNEL_CAPACITY];
+            }
+            in->head.store(head + numToRead, memory_order_release);
+            received += numToRead;
+            hasProgressed |= numToRead > 0;
+        }
+        
+        if (hasProgressed)
+        {
+            lastProgress = chrono::steady_clock::now();
+        }
+        else if (chrono::steady_clock::now() - lastProgress > _timeout)
+        {
+            cerr << "Worker " << _rank << " timed out exchanging data in shared memory" << endl;
+            return false;
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+    return true;
+}
+
+/* ---------- TCP ---------- */
+
+static const int CONNECT_TIMEOUT_MS = 30000;
+
+TcpTransport::TcpTransport(const int rank, const int numOfWorkers, const int basePort, const string& nextHost,
+                           const chrono::milliseconds timeout) :
+    _rank(rank),
+    _numOfWorkers(numOfWorkers),
+    _timeout(timeout),
+    _nextSocket(-1),
+    _previousSocket(-1)
+{
+    if (numOfWorkers == 1)
+    {
+        return;
+    }
+    
+    /* Listening first, so that the previous worker can connect even before we accept */
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int enable = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(basePort + rank);
+    if (::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0)
+    {
+        cerr << "Listening on port " << basePort + rank << " failed" << endl;
+        close(listener);
+        return;
+    }
+    
+    /* Connecting to the next worker (retrying until it listens) */
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* next = nullptr;
+    const string nextPort = to_string(basePort + (rank + 1) % numOfWorkers);
+    if (getaddrinfo(nextHost.c_str(), nextPort.c_str(), &hints, &next) == 0)
+    {
+        for (int waited = 0; waited < CONNECT_TIMEOUT_MS; waited += 10)
+        {
+            _nextSocket = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(_nextSocket, next->ai_addr, next->ai_addrlen) == 0)
+            {
+                break;
+            }
+            close(_nextSocket);
+            _nextSocket = -1;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        freeaddrinfo(next);
+    }
+    
+    if (_nextSocket >= 0)
+    {
+        _previousSocket = accept(listener, nullptr, nullptr);
+    }
+    close(listener);
+    
+    for (const int s : {_nextSocket, _previousSocket})
+    {
+        if (s >= 0)
+        {
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+        }
+    }
+    if (!isConnected())
+    {
+        cerr << "Connecting worker " << rank << " to the ring failed" << endl;
+    }
+}
+
+TcpTransport::~TcpTransport()
+{
+    for (const int s : {_nextSocket, _previousSocket})
+    {
+        if (s >= 0)
+        {
+            close(s);
+        }
+    }
+}
+
+bool TcpTransport::sendReceive(const double* sendData, const size_t sendCount,
+                               double* receiveData, const size_t receiveCount)
+{
+    /* Sending and receiving whatever the sockets accept, so that full socket buffers
+     * cannot deadlock the ring */
+    const char* sendBytes = (const char*)sendData;
+    size_t remainingToSend = sendCount * sizeof(double);
+    char* receiveBytes = (char*)receiveData;
+    size_t remainingToReceive = receiveCount * sizeof(double);
+    
+    while (remainingToSend > 0 || remainingToReceive > 0)
+    {
+        pollfd sockets[2];
+        int numOfSockets = 0;
+        if (remainingToSend > 0)
+        {
+            sockets[numOfSockets++] = {_nextSocket, POLLOUT, 0};
+        }
+        if (remainingToReceive > 0)
+        {
+            sockets[numOfSockets++] = {_previousSocket, POLLIN, 0};
+        }
+        
+        const int numOfReady = poll(sockets, numOfSockets, (int)_timeout.count());
+        if (numOfReady <= 0)
+        {
+            if (numOfReady < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            cerr << "Worker " << _rank << " timed out exchanging data over TCP" << endl;
+            return false;
+        }
+        
+        if (remainingToSend > 0)
+        {
+            const ssize_t numOfSent = send(_nextSocket, sendBytes, remainingToSend, MSG_NOSIGNAL);
+            if (numOfSent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                cerr << "Sending to worker " << (_rank + 1) % _numOfWorkers << " failed" << endl;
+                return false;
+            }
+            if (numOfSent > 0)
+            {
+                sendBytes += numOfSent;
+                remainingToSend -= numOfSent;
+            }
+        }
+        
+        if (remainingToReceive > 0)
+        {
+            const ssize_t numOfReceived = recv(_previousSocket, receiveBytes, remainingToReceive, 0);
+            if (numOfReceived == 0 ||
+                (numOfReceived < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                cerr << "Receiving from worker " << (_rank - 1 + _numOfWorkers) % _numOfWorkers << " failed" << endl;
+                return false;
+            }
+            if (numOfReceived > 0)
+            {
+                receiveBytes += numOfReceived;
+                remainingToReceive -= numOfReceived;
+            }
+        }
+    }
+    return true;
+}
+
+}
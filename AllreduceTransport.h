@@ -0,0 +1,114 @@
+#pragma  once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace NeNet
+{
+
+/**
+ * Point-to-point transport between workers arranged in a ring,
+ * worker (rank) r sends to (r + 1) % N and receives from (r - 1 + N) % N.
+ */
+class AllreduceTransport
+{
+public:
+    virtual ~AllreduceTransport() {}
+    
+    virtual int getRank() = 0;
+    virtual int getNumOfWorkers() = 0;
+    
+    /**
+     * Sends data to the next worker and at the same time receives
+     * data from the previous one (so that the ring cannot deadlock).
+     * Returns false if the data could not be exchanged (e.g. a worker died
+     * or did not respond within the timeout), the ring is then unusable.
+     */
+    virtual bool sendReceive(const double* sendData, const size_t sendCount,
+                             double* receiveData, const size_t receiveCount) = 0;
+};
+
+/**
+ * Sums data of all workers in place (ring reduce-scatter followed by ring allgather).
+ * All workers end up with bitwise identical sums.
+ * Returns false if the transport failed, data is then garbage.
+ */
+bool ringAllreduce(AllreduceTransport& transport, double* data, const size_t count);
+
+/**
+ * Transport via POSIX shared memory segment, for workers on the same host.
+ * Each link of the ring is a lock-free single-producer/single-consumer ring buffer.
+ */
+class SharedMemoryTransport : public AllreduceTransport
+{
+private:
+    struct Channel;
+    
+    const std::string _name;
+    const int _rank;
+    const int _numOfWorkers;
+    const std::chrono::milliseconds _timeout; // without any progress of sendReceive
+    
+    void* _segment;
+    size_t _segmentSize;
+    
+    Channel* getChannel(const int from);
+    
+    static size_t getSegmentSize(const int numOfWorkers);
+    
+public:
+    /**
+     * Creates the segment, must be called (once) before workers are started.
+     */
+    static bool create(const std::string& name, const int numOfWorkers);
+    
+    /**
+     * Removes the segment name, existing mappings stay valid.
+     */
+    static void unlink(const std::string& name);
+    
+    SharedMemoryTransport(const std::string& name, const int rank, const int numOfWorkers,
+                          const std::chrono::milliseconds timeout = std::chrono::milliseconds(30000));
+    ~SharedMemoryTransport();
+    
+    bool isOpen() { return _segment != nullptr; }
+    
+    int getRank() { return _rank; }
+    int getNumOfWorkers() { return _numOfWorkers; }
+    
+    bool sendReceive(const double* sendData, const size_t sendCount,
+                     double* receiveData, const size_t receiveCount);
+};
+
+/**
+ * Transport via TCP, worker r listens on basePort + r
+ * and connects to the next worker at nextHost.
+ * Sending and receiving are interleaved on non-blocking sockets by poll.
+ */
+class TcpTransport : public AllreduceTransport
+{
+private:
+    const int _rank;
+    const int _numOfWorkers;
+    const std::chrono::milliseconds _timeout; // without any progress of sendReceive
+    
+    int _nextSocket;
+    int _previousSocket;
+    
+public:
+    TcpTransport(const int rank, const int numOfWorkers, const int basePort,
+                 const std::string& nextHost = "127.0.0.1",
+                 const std::chrono::milliseconds timeout = std::chrono::milliseconds(30000));
+    ~TcpTransport();
+    
+    bool isConnected() { return _numOfWorkers == 1 || (_nextSocket >= 0 && _previousSocket >= 0); }
+    
+    int getRank() { return _rank; }
+    int getNumOfWorkers() { return _numOfWorkers; }
+    
+    bool sendReceive(const double* sendData, const size_t sendCount,
+                     double* receiveData, const size_t receiveCount);
+};
+
+}
@@ -0,0 +1,262 @@
+#include "AutoTuner.h"
+#include "PipelinedTrainer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace NeNet
+{
+
+static const double MIN_TRIAL_SECONDS = 0.05; // duration of a single timed trial
+static const int NUM_OF_TRIAL_PATTERNS = 512; // trials run on at most this many patterns
+
+/**
+ * Runs given function (which processes numOfPatterns patterns) repeatedly
+ * for at least minSeconds and returns number of patterns processed per second.
+ */
+template<typename Function>
+static double measureThroughput(const int numOfPatterns, const double minSeconds, Function run)
+{
+    run(); // warm-up
+    
+    const auto start = chrono::steady_clock::now();
+    long numOfRuns = 0;
+    double seconds = 0;
+    do {
+        run();
+        numOfRuns++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    
+    return numOfRuns * numOfPatterns / seconds;
+}
+
+/**
+ * Creates network of the same topology and loss function with the same weights.
+ */
+static unique_ptr<NeuralNetwork> copyNetwork(NeuralNetwork& network)
+{
+    unique_ptr<NeuralNetwork> copy(new NeuralNetwork(network.getNumOfInputs(), network.getNumsOfPerceptrons()));
+    copy->setLossFunction(network.getLossFunction());
+    copy->setWeights(network.getWeights());
+    return copy;
+}
+
+AutoTuner::AutoTuner(const string& cacheFilePath) :
+    _cacheFilePath(cacheFilePath)
+{
+    readCache();
+}
+
+string AutoTuner::getDefaultCacheFilePath()
+{
+    char hostName[256] = "localhost";
+    gethostname(hostName, sizeof(hostName) - 1);
+    const char* home = getenv("HOME");
+    return string(home ? home : "/tmp") + "/.nenet-tuning-" + hostName;
+}
+
+int AutoTuner::getMaxNumOfThreads()
+{
+    return max(1, (int)thread::hardware_concurrency());
+}
+
+string AutoTuner::getKey(const string& kind, NeuralNetwork& network)
+{
+    stringstream key;
+    key << kind << " " << network.getNumOfInputs();
+    for (const auto numOfPerceptrons : network.getNumsOfPerceptrons())
+    {
+        key << "-" << numOfPerceptrons;
+    }
+    key << " " << network.getLossFunction();
+    return key.str();
+}
+
+void AutoTuner::readCache()
+{
+    /* Each line: kind topology loss variant batchSize numOfThreads throughput */
+    ifstream file(_cacheFilePath);
+    string line;
+    while (getline(file, line))
+    {
+        stringstream ss(line);
+        string kind, topology, loss;
+        TuningResult result;
+        if (ss >> kind >> topology >> loss >> result.variant >> result.batchSize >> result.numOfThreads >> result.throughput)
+        {
+            _cache[kind + " " + topology + " " + loss] = result;
+        }
+    }
+}
+
+bool AutoTuner::writeCache()
+{
+    const string tempPath = _cacheFilePath + ".tmp";
+    ofstream file(tempPath);
+    for (const auto& entry : _cache)
+    {
+        const auto& result = entry.second;
+        file << entry.first << " " << result.variant << " " << result.batchSize << " "
+             << result.numOfThreads << " " << result.throughput << "\n";
+    }
+    file.close();
+    
+    return file && rename(tempPath.c_str(), _cacheFilePath.c_str()) == 0;
+}
+
+TuningResult AutoTuner::tuneTraining(NeuralNetwork& network,
+                                     const vector<pair<vector<double>, double>>& patterns,
+                                     const bool forceTrials)
+{
+    const string key = getKey("training", network);
+    if (!forceTrials && _cache.count(key))
+    {
+        return _cache[key];
+    }
+    
+    const vector<pair<vector<double>, double>> trialPatterns(patterns.begin(),
+        patterns.begin() + min((int)patterns.size(), NUM_OF_TRIAL_PATTERNS));
+    const int numOfTrialPatterns = (int)trialPatterns.size();
+    const double stepSize = 0.01;
+    
+    /* Sequential training on the object graph */
+    TuningResult best = {"sequential", 1, 1, 0};
+    {
+        auto trial = copyNetwork(network);
+        best.throughput = measureThroughput(numOfTrialPatterns, MIN_TRIAL_SECONDS, [&] {
+            trial->partialFit(trialPatterns, stepSize);
+        });
+    }
+    
+    /* Pipelined mini-batch training */
+    const int maxNumOfStages = min(getMaxNumOfThreads(), (int)network.getNumsOfPerceptrons().size());
+    for (int numOfStages = 1; numOfStages <= maxNumOfStages; numOfStages *= 2)
+    {
+        for (const int batchSize : {8, 32, 128})
+        {
+            auto trial = copyNetwork(network);
+            PipelinedTrainer trainer(numOfStages, batchSize, max(1, batchSize / numOfStages));
+            trainer.setPrintProgress(false);
+            const double throughput = measureThroughput(numOfTrialPatterns, MIN_TRIAL_SECONDS, [&] {
+                trainer.train(*trial, trialPatterns, 1, stepSize);
+            });
+            
+            if (throughput > best.throughput)
+            {
+                best = {"pipelined", batchSize, numOfStages, throughput};
+            }
+        }
+    }
+    
+    _cache[key] = best;
+    writeCache();
+    return best;
+}
+
+TuningResult AutoTuner::tuneInference(NeuralNetwork& network,
+                                      const vector<vector<double>>& inputs,
+                                      const bool forceTrials)
+{
+    const string key = getKey("inference", network);
+    if (!forceTrials && _cache.count(key))
+    {
+        return _cache[key];
+    }
+    
+    const vector<vector<double>> trialInputs(inputs.begin(),
+        inputs.begin() + min((int)inputs.size(), NUM_OF_TRIAL_PATTERNS));
+    const int numOfTrialInputs = (int)trialInputs.size();
+    auto trial = copyNetwork(network);
+    
+    /* Single-sample use with parallel layers, which makes difference only
+       if some layer is wide enough to be split among the threads */
+    const auto numsOfPerceptrons = network.getNumsOfPerceptrons();
+    const int widestLayerSize = *max_element(numsOfPerceptrons.begin(), numsOfPerceptrons.end());
+    const int maxNumOfThreads = widestLayerSize >= NeuralNetwork::DEFAULT_MIN_PARALLEL_LAYER_SIZE ? getMaxNumOfThreads() : 1;
+    
+    TuningResult best = {"use", 1, 1, 0};
+    for (int numOfThreads = 1; numOfThreads <= maxNumOfThreads; numOfThreads *= 2)
+    {
+        trial->setNumOfForwardThreads(numOfThreads);
+        const double throughput = measureThroughput(numOfTrialInputs, MIN_TRIAL_SECONDS, [&] {
+            for (const auto& input : trialInputs)
+            {
+                trial->use(input);
+            }
+        });
+        
+        if (throughput > best.throughput)
+        {
+            best = {"use", 1, numOfThreads, throughput};
+        }
+    }
+    trial->setNumOfForwardThreads(1);
+    
+    /* Batched use */
+    for (const int batchSize : {8, 32, 128, 512})
+    {
+        const double throughput = measureThroughput(numOfTrialInputs, MIN_TRIAL_SECONDS, [&] {
+            for (int first = 0; first < numOfTrialInputs; first += batchSize)
+            {
+                const int last = min(numOfTrialInputs, first + batchSize);
+                trial->useBatch(vector<vector<double>>(trialInputs.begin() + first, trialInputs.begin() + last));
+            }
+        });
+        
+        if (throughput > best.throughput)
+        {
+            best = {"useBatch", batchSize, 1, throughput};
+        }
+    }
+    
+    _cache[key] = best;
+    writeCache();
+    return best;
+}
+
+bool AutoTuner::train(NeuralNetwork& network,
+                      const vector<pair<vector<double>, double>>& patterns,
+                      const int numOfEpochs,
+                      const double stepSize)
+{
+    if (!network.areWeightsInitialized())
+    {
+        return false;
+    }
+    
+    const TuningResult tuned = tuneTraining(network, patterns);
+    if (tuned.variant == "pipelined")
+    {
+        PipelinedTrainer trainer(tuned.numOfThreads, tuned.batchSize, max(1, tuned.batchSize / tuned.numOfThreads));
+        trainer.setPrintProgress(false);
+        trainer.train(network, patterns, numOfEpochs, stepSize);
+    }
+    else
+    {
+        /* Same as warm-started NeuralNetwork::train, epoch by epoch */
+        for (int i = 0; i < numOfEpochs; i++)
+        {
+            network.partialFit(patterns, stepSize);
+        }
+    }
+    return true;
+}
+
+TuningResult AutoTuner::configureInference(NeuralNetwork& network, const vector<vector<double>>& inputs)
+{
+    const TuningResult tuned = tuneInference(network, inputs);
+    network.setNumOfForwardThreads(tuned.variant == "use" ? tuned.numOfThreads : 1);
+    return tuned;
+}
+
+}
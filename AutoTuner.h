@@ -0,0 +1,91 @@
+#pragma  once
+
+#include "NeuralNetwork.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Winning configuration for one topology on this host.
+ *
+ * Training variants: "sequential" (NeuralNetwork::train) and
+ * "pipelined" (PipelinedTrainer with numOfThreads stages and mini-batches of batchSize).
+ * Inference variants: "use" (NeuralNetwork::use with numOfThreads forward threads)
+ * and "useBatch" (NeuralNetwork::useBatch with batches of batchSize).
+ */
+struct TuningResult
+{
+    std::string variant;
+    int batchSize;
+    int numOfThreads;
+    double throughput; // patterns per second measured in the trial
+};
+
+/**
+ * Picks the fastest training and inference configuration for topology of given network
+ * by short timed trials, and remembers the winners in a per-host cache file,
+ * so that the trials run only once per topology and host.
+ *
+ * Note that mini-batch variants of training converge differently than sequential
+ * training, the tuner looks only at throughput.
+ */
+class AutoTuner
+{
+private:
+    const std::string _cacheFilePath;
+    std::map<std::string, TuningResult> _cache; // by kind and topology
+    
+    void readCache();
+    bool writeCache();
+    
+    static std::string getKey(const std::string& kind, NeuralNetwork& network);
+    
+    static int getMaxNumOfThreads();
+    
+public:
+    /**
+     * Default cache file is ~/.nenet-tuning-<host name>.
+     */
+    explicit AutoTuner(const std::string& cacheFilePath = getDefaultCacheFilePath());
+    
+    static std::string getDefaultCacheFilePath();
+    
+    /**
+     * Returns the fastest training configuration for the network topology,
+     * from the cache or from new trials on given patterns.
+     * Weights of the network are not changed.
+     */
+    TuningResult tuneTraining(NeuralNetwork& network,
+                              const std::vector<std::pair<std::vector<double>, double>>& patterns,
+                              const bool forceTrials = false);
+    
+    /**
+     * Returns the fastest inference configuration for the network topology,
+     * from the cache or from new trials on given inputs.
+     */
+    TuningResult tuneInference(NeuralNetwork& network,
+                               const std::vector<std::vector<double>>& inputs,
+                               const bool forceTrials = false);
+    
+    /**
+     * Trains the network in the tuned configuration (tuning first if needed),
+     * starting from its current weights (without printing progress).
+     * Returns false and trains nothing if weights of the network are not initialized.
+     */
+    bool train(NeuralNetwork& network,
+               const std::vector<std::pair<std::vector<double>, double>>& patterns,
+               const int numOfEpochs,
+               const double stepSize);
+    
+    /**
+     * Sets number of forward threads of the network to the tuned value and returns
+     * the tuned configuration (batchSize is useful e.g. for InferenceServer).
+     */
+    TuningResult configureInference(NeuralNetwork& network, const std::vector<std::vector<double>>& inputs);
+};
+
+}
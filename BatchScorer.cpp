@@ -0,0 +1,406 @@
+//
+//  Streaming batch scoring with a trained network.
+//
+//  Loads the network from a checkpoint (NeuralNetwork::saveCheckpoint, which records
+//  also the loss function, so softmax output layer is restored as well),
+//  reads the input in chunks of rows, scores the chunks on worker threads
+//  and writes the outputs in the order of the input rows. Only a bounded number
+//  of chunks is in memory at once, so inputs of any size can be scored.
+//  Throughput (rows/sec) is reported to stderr while scoring and at the end.
+//
+//  Input formats:
+//    csv - one row per line, numOfInputs comma-separated values,
+//          outputs are written as one comma-separated line per row
+//    bin - raw doubles, numOfInputs per row,
+//          outputs are written as raw doubles, numOfOutputs per row
+//
+//  Usage: BatchScorer model input output [csv|bin] [numOfThreads] [rowsPerChunk]
+//  ("-" as input or output means stdin or stdout)
+//
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "NeuralNetwork.h"
+
+using namespace std;
+using namespace NeNet;
+
+static const int CHUNKS_IN_FLIGHT_PER_THREAD = 2;
+static const double REPORT_INTERVAL_SECONDS = 5;
+
+/**
+ * Rows read from input, scored by a worker and written by the writer.
+ */
+struct Chunk
+{
+    long index; // order of the chunk in input
+    long firstRow;
+    vector<string> lines; // csv rows
+    vector<double> values; // bin rows
+    string output; // formatted outputs
+    string error; // non-empty if the chunk could not be scored
+};
+
+/**
+ * Hands chunks from the reader to the workers and scored chunks to the writer in input order,
+ * while at most maxChunksInFlight chunks are read but not yet written.
+ */
+class ChunkPipeline
+{
+private:
+    const int _maxChunksInFlight;
+    
+    mutex _mutex;
+    condition_variable _condition;
+    queue<shared_ptr<Chunk>> _unscored;
+    map<long, shared_ptr<Chunk>> _scored; // by index
+    int _numOfChunksInFlight;
+    bool _isInputFinished;
+    bool _isCancelled;
+
+public:
+    ChunkPipeline(const int maxChunksInFlight) :
+        _maxChunksInFlight(maxChunksInFlight),
+        _numOfChunksInFlight(0),
+        _isInputFinished(false),
+        _isCancelled(false)
+    {}
+    
+    /**
+     * Blocks while too many chunks are in flight. Returns false if scoring was cancelled.
+     */
+    bool pushUnscored(const shared_ptr<Chunk>& chunk)
+    {
+        unique_lock<mutex> lock(_mutex);
+        _condition.wait(lock, [this] { return _numOfChunksInFlight < _maxChunksInFlight || _isCancelled; });
+        if (_isCancelled)
+        {
+            return false;
+        }
+        _numOfChunksInFlight++;
+        _unscored.push(chunk);
+        _condition.notify_all();
+        return true;
+    }
+    
+    void finishInput()
+    {
+        lock_guard<mutex> lock(_mutex);
+        _isInputFinished = true;
+        _condition.notify_all();
+    }
+    
+    void cancel()
+    {
+        lock_guard<mutex> lock(_mutex);
+        _isCancelled = true;
+        _condition.notify_all();
+    }
+    
+    /**
+     * Returns null when there is nothing more to score.
+     */
+    shared_ptr<Chunk> popUnscored()
+    {
+        unique_lock<mutex> lock(_mutex);
+        _condition.wait(lock, [this] { return !_unscored.empty() || _isInputFinished || _isCancelled; });
+        if (_unscored.empty() || _isCancelled)
+        {
+            return nullptr;
+        }
+        auto chunk = _unscored.front();
+        _unscored.pop();
+        return chunk;
+    }
+    
+    void pushScored(const shared_ptr<Chunk>& chunk)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _scored[chunk->index] = chunk;
+        _condition.notify_all();
+    }
+    
+    /**
+     * Returns scored chunk of given index, or null when there are no more chunks.
+     */
+    shared_ptr<Chunk> popScored(const long index)
+    {
+        unique_lock<mutex> lock(_mutex);
+        _condition.wait(lock, [this, index] {
+            return _scored.count(index) || (_isInputFinished && _numOfChunksInFlight == 0) || _isCancelled;
+        });
+        if (!_scored.count(index) || _isCancelled)
+        {
+            return nullptr;
+        }
+        auto chunk = _scored[index];
+        _scored.erase(index);
+        _numOfChunksInFlight--;
+        _condition.notify_all();
+        return chunk;
+    }
+};
+
+/**
+ * Parses rows of the chunk, scores them and formats the outputs.
+ */
+static void scoreChunk(NeuralNetwork& network, Chunk& chunk, const bool isBinary)
+{
+    const int numOfInputs = network.getNumOfInputs();
+    vector<vector<double>> inputs;
+    
+    if (isBinary)
+    {
+        for (int first = 0; first < chunk.values.size(); first += numOfInputs)
+        {
+            inputs.push_back(vector<double>(chunk.values.begin() + first, chunk.values.begin() + first + numOfInputs));
+        }
+    }
+    else
+    {
+        for (int i = 0; i < chunk.lines.size(); i++)
+        {
+            vector<double> input;
+            const char* position = chunk.lines[i].c_str();
+            char* end;
+            while (input.size() < numOfInputs)
+            {
+                const double value = strtod(position, &end);
+                if (end == position)
+                {
+                    break;
+                }
+                input.push_back(value);
+                position = end;
+                while (*position == ',' || *position == ' ' || *position == '\t' || *position == '\r')
+                {
+                    position++;
+                }
+            }
+    
+            if (input.size() != numOfInputs || *position != '\0')
+            {
+                chunk.error = "Malformed row " + to_string(chunk.firstRow + i + 1) +
+                              ", expected " + to_string(numOfInputs) + " values";
+                return;
+            }
+            inputs.push_back(input);
+        }
+    }
+    
+    const vector<vector<double>> outputs = network.useBatch(inputs);
+    
+    if (isBinary)
+    {
+        for (const auto& output : outputs)
+        {
+            chunk.output.append(reinterpret_cast<const char*>(output.data()), output.size() * sizeof(double));
+        }
+    }
+    else
+    {
+        stringstream ss;
+        ss.precision(numeric_limits<double>::max_digits10);
+        for (const auto& output : outputs)
+        {
+            for (int i = 0; i < output.size(); i++)
+            {
+                ss << (i ? "," : "") << output[i];
+            }
+            ss << "\n";
+        }
+        chunk.output = ss.str();
+    }
+    chunk.lines.clear();
+    chunk.values.clear();
+}
+
+/**
+ * Reads chunks from input and pushes them to the pipeline.
+ * Returns false if input is malformed or scoring was cancelled.
+ */
+static bool readChunks(istream& input, ChunkPipeline& pipeline, const bool isBinary,
+                       const int numOfInputs, const int rowsPerChunk, string& error)
+{
+    long numOfRows = 0;
+    for (long index = 0; ; index++)
+    {
+        auto chunk = make_shared<Chunk>();
+        chunk->index = index;
+        chunk->firstRow = numOfRows;
+    
+        if (isBinary)
+        {
+            chunk->values.resize((size_t)rowsPerChunk * numOfInputs);
+            input.read(reinterpret_cast<char*>(chunk->values.data()), chunk->values.size() * sizeof(double));
+            const long numOfBytes = input.gcount();
+            if (numOfBytes % (numOfInputs * sizeof(double)) != 0)
+            {
+                error = "Input ends in the middle of row " + to_string(numOfRows + numOfBytes / (numOfInputs * sizeof(double)) + 1);
+                return false;
+            }
+            chunk->values.resize(numOfBytes / sizeof(double));
+            numOfRows += numOfBytes / (numOfInputs * sizeof(double));
+        }
+        else
+        {
+            string line;
+            while (chunk->lines.size() < rowsPerChunk && getline(input, line))
+            {
+                chunk->lines.push_back(line);
+            }
+            numOfRows += chunk->lines.size();
+        }
+    
+        if (chunk->lines.empty() && chunk->values.empty())
+        {
+            return true;
+        }
+        if (!pipeline.pushUnscored(chunk))
+        {
+            return false;
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 4)
+    {
+        cerr << "Usage: " << argv[0] << " model input output [csv|bin] [numOfThreads] [rowsPerChunk]" << endl;
+        return 1;
+    }
+    const string modelPath = argv[1];
+    const string inputPath = argv[2];
+    const string outputPath = argv[3];
+    const bool isBinary = argc > 4 && string(argv[4]) == "bin";
+    const int numOfThreads = argc > 5 ? max(1, atoi(argv[5])) : max(1, (int)thread::hardware_concurrency());
+    const int rowsPerChunk = argc > 6 ? max(1, atoi(argv[6])) : 4096;
+    
+    Checkpoint model;
+    if (!readCheckpoint(modelPath, model))
+    {
+        cerr << "Reading model " << modelPath << " failed: missing file, other checkpoint version,"
+             << " invalid topology or number of weights not matching topology" << endl;
+        return 1;
+    }
+    
+    ifstream inputFile;
+    ofstream outputFile;
+    if (inputPath != "-")
+    {
+        inputFile.open(inputPath, isBinary ? ios::binary : ios::in);
+        if (!inputFile)
+        {
+            cerr << "Opening input " << inputPath << " failed" << endl;
+            return 1;
+        }
+    }
+    if (outputPath != "-")
+    {
+        outputFile.open(outputPath, isBinary ? ios::binary : ios::out);
+        if (!outputFile)
+        {
+            cerr << "Opening output " << outputPath << " failed" << endl;
+            return 1;
+        }
+    }
+    istream& input = inputPath != "-" ? inputFile : cin;
+    ostream& output = outputPath != "-" ? outputFile : cout;
+    
+    /* Each worker scores on its own copy of the network */
+    vector<unique_ptr<NeuralNetwork>> networks;
+    for (int i = 0; i < numOfThreads; i++)
+    {
+        networks.emplace_back(new NeuralNetwork(model.numOfInputs, model.numsOfPerceptrons));
+        networks.back()->setLossFunction(model.lossFunction);
+        networks.back()->setWeights(model.weights);
+    }
+    
+    ChunkPipeline pipeline(numOfThreads * CHUNKS_IN_FLIGHT_PER_THREAD);
+    
+    vector<thread> workers;
+    for (int i = 0; i < numOfThreads; i++)
+    {
+        workers.emplace_back([&pipeline, &networks, i, isBinary] {
+            while (auto chunk = pipeline.popUnscored())
+            {
+                scoreChunk(*networks[i], *chunk, isBinary);
+                pipeline.pushScored(chunk);
+            }
+        });
+    }
+    
+    /* Writer, writes chunks in order of input and reports throughput */
+    string writerError;
+    long numOfScoredRows = 0;
+    const auto start = chrono::steady_clock::now();
+    thread writer([&] {
+        const int numOfOutputs = model.numsOfPerceptrons.back();
+        double lastReportSeconds = 0;
+        for (long index = 0; ; index++)
+        {
+            const auto chunk = pipeline.popScored(index);
+            if (!chunk)
+            {
+                break;
+            }
+            if (!chunk->error.empty() || !output.write(chunk->output.data(), chunk->output.size()))
+            {
+                writerError = chunk->error.empty() ? "Writing output failed" : chunk->error;
+                pipeline.cancel();
+                break;
+            }
+    
+            numOfScoredRows += isBinary ? chunk->output.size() / (numOfOutputs * sizeof(double))
+                                        : count(chunk->output.begin(), chunk->output.end(), '\n');
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (seconds - lastReportSeconds >= REPORT_INTERVAL_SECONDS)
+            {
+                cerr << numOfScoredRows << " rows, " << (long)(numOfScoredRows / seconds) << " rows/sec" << endl;
+                lastReportSeconds = seconds;
+            }
+        }
+    });
+    
+    string readerError;
+    readChunks(input, pipeline, isBinary, model.numOfInputs, rowsPerChunk, readerError);
+    if (!readerError.empty())
+    {
+        pipeline.cancel();
+    }
+    pipeline.finishInput();
+    
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    writer.join();
+    output.flush();
+    
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Scored " << numOfScoredRows << " rows in " << seconds << " s on " << numOfThreads << " threads, "
+         << (long)(numOfScoredRows / max(seconds, 1e-9)) << " rows/sec" << endl;
+    
+    const string error = !readerError.empty() ? readerError : writerError;
+    if (!error.empty() || !output)
+    {
+        cerr << (error.empty() ? "Writing output failed" : error) << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "Checkpoint.h"
+#include "NeuralNetwork.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+
+namespace NeNet
+{
+
+static const string CHECKPOINT_HEADER = "NeNet-checkpoint 2"; // version 2 added loss function
+
+bool writeCheckpoint(const Checkpoint& checkpoint, const string& filePath)
+{
+    const string tempPath = filePath + ".tmp";
+    
+    ofstream file(tempPath);
+    if (!file)
+    {
+        return false;
+    }
+    
+    file.precision(numeric_limits<double>::max_digits10);
+    file << CHECKPOINT_HEADER << "\n";
+    file << checkpoint.numOfInputs << " " << checkpoint.numsOfPerceptrons.size();
+    for (const auto numOfPerceptrons : checkpoint.numsOfPerceptrons)
+    {
+        file << " " << numOfPerceptrons;
+    }
+    file << "\n";
+    file << checkpoint.lossFunction << "\n";
+    file << checkpoint.epoch << " " << checkpoint.stepSize << " " << checkpoint.numOfSeenPatterns << "\n";
+    file << checkpoint.weights.size() << "\n";
+    for (const auto weight : checkpoint.weights)
+    {
+        file << weight << "\n";
+    }
+    
+    file.close();
+    if (!file)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    
+    return rename(tempPath.c_str(), filePath.c_str()) == 0;
+}
+
+bool readCheckpoint(const string& filePath, Checkpoint& checkpoint)
+{
+    ifstream file(filePath);
+    string header;
+    if (!getline(file, header) || header != CHECKPOINT_HEADER)
+    {
+        return false;
+    }
+    
+    int numOfLayers;
+    if (!(file >> checkpoint.numOfInputs >> numOfLayers) || checkpoint.numOfInputs <= 0 || numOfLayers <= 0)
+    {
+        return false;
+    }
+    checkpoint.numsOfPerceptrons.resize(numOfLayers);
+    for (auto& numOfPerceptrons : checkpoint.numsOfPerceptrons)
+    {
+        if (!(file >> numOfPerceptrons) || numOfPerceptrons <= 0)
+        {
+            return false;
+        }
+    }
+    int lossFunction;
+    file >> lossFunction;
+    if (lossFunction != SQUARED_ERROR && lossFunction != CROSS_ENTROPY)
+    {
+        return false;
+    }
+    checkpoint.lossFunction = (LossFunction)lossFunction;
+    file >> checkpoint.epoch >> checkpoint.stepSize >> checkpoint.numOfSeenPatterns;
+    
+    /* Number of weights must match the topology */
+    size_t numOfWeights;
+    if (!(file >> numOfWeights) ||
+        numOfWeights != NeuralNetwork::getNumOfWeights(checkpoint.numOfInputs, checkpoint.numsOfPerceptrons))
+    {
+        return false;
+    }
+    checkpoint.weights.resize(numOfWeights);
+    for (auto& weight : checkpoint.weights)
+    {
+        file >> weight;
+    }
+    
+    return (bool)file;
+}
+
+CheckpointWriter::CheckpointWriter(const string& filePath) :
+    _filePath(filePath),
+    _hasPending(false),
+    _isWriting(false),
+    _stop(false)
+{
+    _thread = thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+}
+
+void CheckpointWriter::submit(Checkpoint checkpoint)
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _pending = move(checkpoint);
+        _hasPending = true;
+    }
+    _condition.notify_all();
+}
+
+void CheckpointWriter::flush()
+{
+    unique_lock<mutex> lock(_mutex);
+    _condition.wait(lock, [this] { return !_hasPending && !_isWriting; });
+}
+
+void CheckpointWriter::run()
+{
+    unique_lock<mutex> lock(_mutex);
+    while (true)
+    {
+        _condition.wait(lock, [this] { return _hasPending || _stop; });
+        if (!_hasPending)
+        {
+            return;
+        }
+        
+        Checkpoint checkpoint = move(_pending);
+        _hasPending = false;
+        _isWriting = true;
+        lock.unlock();
+        
+        if (!writeCheckpoint(checkpoint, _filePath))
+        {
+            cerr << "Writing checkpoint " << _filePath << " failed" << endl;
+        }
+        
+        lock.lock();
+        _isWriting = false;
+        _condition.notify_all();
+    }
+}
+
+}
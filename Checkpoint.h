@@ -0,0 +1,82 @@
+#pragma  once
+
+#include "Perceptron.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Snapshot of the network and of the state of training,
+ * sufficient for resuming the training exactly where it stopped.
+ */
+struct Checkpoint
+{
+    int numOfInputs;
+    std::vector<int> numsOfPerceptrons;
+    LossFunction lossFunction; // determines also whether output layer is softmax
+    std::vector<double> weights; // weights of all edges in order of NeuralNetwork::getEdges()
+    int epoch; // number of finished epochs
+    double stepSize; // current step size (decreased one if learning rate is decreasing)
+    long numOfSeenPatterns;
+};
+
+/**
+ * Writes checkpoint to temporary file first and then renames it to filePath,
+ * so filePath always contains either the old or the new checkpoint.
+ * Returns false if the checkpoint could not be written.
+ */
+bool writeCheckpoint(const Checkpoint& checkpoint, const std::string& filePath);
+
+/**
+ * Reads checkpoint written by writeCheckpoint.
+ * Returns false if the file is missing, malformed or of other version,
+ * or if the number of weights does not match the topology.
+ */
+bool readCheckpoint(const std::string& filePath, Checkpoint& checkpoint);
+
+/**
+ * Writes checkpoints on a background thread, so training is not stalled by I/O.
+ * Only the latest submitted checkpoint is kept if the writer falls behind.
+ */
+class CheckpointWriter
+{
+private:
+    const std::string _filePath;
+    
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    Checkpoint _pending;
+    bool _hasPending;
+    bool _isWriting;
+    bool _stop;
+    
+    std::thread _thread;
+    
+    void run();
+    
+public:
+    CheckpointWriter(const std::string& filePath);
+    
+    /**
+     * Writes pending checkpoint (if any) and stops the background thread.
+     */
+    ~CheckpointWriter();
+    
+    /**
+     * Hands the snapshot over to the background thread and returns immediately.
+     */
+    void submit(Checkpoint checkpoint);
+    
+    /**
+     * Blocks until all submitted checkpoints are written.
+     */
+    void flush();
+};
+
+}
@@ -0,0 +1,103 @@
+#include "CodeExporter.h"
+
+#include <fstream>
+#include <limits>
+
+using namespace std;
+
+namespace NeNet
+{
+
+bool exportToCpp(NeuralNetwork& network, const string& name, const string& filePath)
+{
+    const int numOfInputs = network.getNumOfInputs();
+    const vector<int> numsOfPerceptrons = network.getNumsOfPerceptrons();
+    const int numOfLayers = (int)numsOfPerceptrons.size();
+    const vector<double> weights = network.getWeights();
+    const bool hasSoftmaxOutput = network.hasSoftmaxOutput();
+    
+    ofstream file(filePath);
+    if (!file)
+    {
+        return false;
+    }
+    file.precision(numeric_limits<double>::max_digits10);
+    
+    file << "// Generated by NeNet::exportToCpp, do not edit.\n";
+    file << "// Topology: " << numOfInputs << " inputs";
+    for (const auto numOfPerceptrons : numsOfPerceptrons)
+    {
+        file << ", " << numOfPerceptrons;
+    }
+    file << "\n\n";
+    file << "#pragma once\n\n";
+    file << "#include <cmath>\n\n";
+    file << "namespace " << name << "\n{\n\n";
+    file << "constexpr int NUM_OF_INPUTS = " << numOfInputs << ";\n";
+    file << "constexpr int NUM_OF_OUTPUTS = " << numsOfPerceptrons.back() << ";\n\n";
+    
+    /* Weights of each layer, ordered by origin (bias first), then by destination */
+    int offset = 0;
+    for (int layer = 0; layer < numOfLayers; layer++)
+    {
+        const int numOfLayerInputs = layer == 0 ? numOfInputs : numsOfPerceptrons[layer - 1];
+        const int numOfLayerWeights = (numOfLayerInputs + 1) * numsOfPerceptrons[layer];
+        file << "constexpr double WEIGHTS_" << layer << "[" << numOfLayerWeights << "] = {";
+        for (int i = 0; i < numOfLayerWeights; i++)
+        {
+            file << (i % 4 == 0 ? "\n    " : " ") << weights[offset + i] << (i + 1 < numOfLayerWeights ? "," : "");
+        }
+        file << "\n};\n\n";
+        offset += numOfLayerWeights;
+    }
+    
+    file << "inline double sigmoid(const double x)\n{\n";
+    file << "    return 1.0 / (1.0 + std::exp(-1.0 * x));\n}\n\n";
+    
+    /* Straight-line inference, summation order is the same as in computeWeightedSums of Activation.h */
+    file << "inline void use(const double* input, double* output)\n{\n";
+    for (int layer = 0; layer < numOfLayers; layer++)
+    {
+        const int numOfLayerInputs = layer == 0 ? numOfInputs : numsOfPerceptrons[layer - 1];
+        const int layerSize = numsOfPerceptrons[layer];
+        for (int to = 0; to < layerSize; to++)
+        {
+            if (layer == numOfLayers - 1) {
+                file << "    output[" << to << "]";
+            } else {
+                file << "    const double p" << layer << "_" << to;
+            }
+            const bool isSoftmax = hasSoftmaxOutput && layer == numOfLayers - 1;
+            file << (isSoftmax ? " = (" : " = sigmoid(") << "0.0 + 1.0 * WEIGHTS_" << layer << "[" << to << "]";
+            for (int from = 0; from < numOfLayerInputs; from++)
+            {
+                file << "\n        + ";
+                if (layer == 0) {
+                    file << "input[" << from << "]";
+                } else {
+                    file << "p" << layer - 1 << "_" << from;
+                }
+                file << " * WEIGHTS_" << layer << "[" << (from + 1) * layerSize + to << "]";
+            }
+            file << ");\n";
+        }
+    }
+    
+    /* Softmax output layer, same steps as softmax in Activation.h (generated header is standalone) */
+    if (hasSoftmaxOutput)
+    {
+        file << "    double maxWeightedSum = output[0];\n";
+        file << "    for (int i = 0; i < NUM_OF_OUTPUTS; i++) { maxWeightedSum = output[i] > maxWeightedSum ? output[i] : maxWeightedSum; }\n";
+        file << "    double sum = 0;\n";
+        file << "    for (int i = 0; i < NUM_OF_OUTPUTS; i++) { output[i] = std::exp(output[i] - maxWeightedSum); sum += output[i]; }\n";
+        file << "    for (int i = 0; i < NUM_OF_OUTPUTS; i++) { output[i] = output[i] / sum; }\n";
+    }
+    file << "}\n\n";
+    
+    file << "}\n";
+    
+    file.close();
+    return (bool)file;
+}
+
+}
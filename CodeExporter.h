@@ -0,0 +1,21 @@
+#pragma  once
+
+#include "NeuralNetwork.h"
+
+#include <string>
+
+namespace NeNet
+{
+
+/**
+ * Generates standalone, dependency free C++ header with trained network.
+ *
+ * Header contains weights as constexpr arrays and straight-line inference function
+ *     void <name>::use(const double* input, double* output)
+ * which performs the same arithmetic as NeuralNetwork::use
+ * (weights are written with full precision, so outputs are identical).
+ * Returns false if the file could not be written.
+ */
+bool exportToCpp(NeuralNetwork& network, const std::string& name, const std::string& filePath);
+
+}
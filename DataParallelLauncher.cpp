@@ -0,0 +1,163 @@
+//
+//  Launcher of local data-parallel training.
+//
+//  Spawns N worker processes which train the same network on shards
+//  of the patterns (combining gradients by ring allreduce) and verifies
+//  that the final weights match single-process mini-batch training.
+//
+//  Usage: DataParallelLauncher [numOfWorkers] [shm|tcp]
+//
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "DataParallelTrainer.h"
+#include "NeuralNetwork.h"
+#include "PipelinedTrainer.h"
+
+using namespace std;
+using namespace NeNet;
+
+static const unsigned int SEED = 42;
+static const int NUM_OF_INPUTS = 2;
+static const vector<int> NUMS_OF_PERCEPTRONS = {7, 1};
+static const int NUM_OF_PATTERNS = 2000;
+static const int NUM_OF_EPOCHS = 20;
+static const int GLOBAL_BATCH_SIZE = 64;
+static const double STEP_SIZE = 1.0;
+static const int BASE_PORT = 47000;
+static const double TOLERANCE = 1e-9;
+
+/**
+ * Torus from main.cpp, generated with fixed seed so that all workers have the same patterns.
+ */
+static vector<pair<vector<double>, double>> generatePatterns()
+{
+    mt19937 generator(SEED);
+    uniform_real_distribution<double> distribution(0, 1);
+    
+    vector<pair<vector<double>, double>> patterns;
+    for (int i = 0; i < NUM_OF_PATTERNS; i++)
+    {
+        const double x = distribution(generator);
+        const double y = distribution(generator);
+        const double distance = sqrt(pow(x - 0.5, 2) + pow(y - 0.5, 2));
+        patterns.push_back(make_pair(vector<double>{x, y}, distance <= 0.3 ? 1.0 : 0.0));
+    }
+    return patterns;
+}
+
+static int runWorker(const int rank, const int numOfWorkers, const string& transportType,
+                     const string& shmName, const string& resultPath)
+{
+    const auto patterns = generatePatterns();
+    NeuralNetwork network(NUM_OF_INPUTS, NUMS_OF_PERCEPTRONS);
+    network.setSeed(SEED);
+    network.initializeWeights(0, 1);
+    
+    if (transportType == "tcp")
+    {
+        TcpTransport transport(rank, numOfWorkers, BASE_PORT);
+        if (!transport.isConnected())
+        {
+            return 1;
+        }
+        if (!DataParallelTrainer(transport, GLOBAL_BATCH_SIZE).train(network, patterns, NUM_OF_EPOCHS, STEP_SIZE))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        SharedMemoryTransport transport(shmName, rank, numOfWorkers);
+        if (!transport.isOpen())
+        {
+            return 1;
+        }
+        if (!DataParallelTrainer(transport, GLOBAL_BATCH_SIZE).train(network, patterns, NUM_OF_EPOCHS, STEP_SIZE))
+        {
+            return 1;
+        }
+    }
+    
+    if (rank == 0 && !network.saveCheckpoint(resultPath, NUM_OF_EPOCHS, STEP_SIZE))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    const int numOfWorkers = argc > 1 ? max(1, atoi(argv[1])) : 4;
+    const string transportType = argc > 2 ? argv[2] : "shm";
+    const string shmName = "/NeNet-allreduce-" + to_string(getpid());
+    const string resultPath = "/tmp/NeNet-data-parallel-" + to_string(getpid()) + ".checkpoint";
+    
+    if (transportType == "shm" && !SharedMemoryTransport::create(shmName, numOfWorkers))
+    {
+        cerr << "Creating shared memory failed" << endl;
+        return 1;
+    }
+    
+    /* Spawning workers */
+    vector<pid_t> workers;
+    for (int rank = 0; rank < numOfWorkers; rank++)
+    {
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            _exit(runWorker(rank, numOfWorkers, transportType, shmName, resultPath));
+        }
+        workers.push_back(pid);
+    }
+    
+    bool haveWorkersSucceeded = true;
+    for (const auto pid : workers)
+    {
+        int status;
+        waitpid(pid, &status, 0);
+        haveWorkersSucceeded &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    if (transportType == "shm")
+    {
+        SharedMemoryTransport::unlink(shmName);
+    }
+    
+    Checkpoint result;
+    if (!haveWorkersSucceeded || !readCheckpoint(resultPath, result))
+    {
+        cerr << "Workers failed" << endl;
+        return 1;
+    }
+    unlink(resultPath.c_str());
+    
+    /* Reference: single-process training with the same seed and global mini-batch */
+    cout << "-----SINGLE PROCESS-----\n";
+    NeuralNetwork reference(NUM_OF_INPUTS, NUMS_OF_PERCEPTRONS);
+    reference.setSeed(SEED);
+    reference.initializeWeights(0, 1);
+    PipelinedTrainer(1, GLOBAL_BATCH_SIZE, GLOBAL_BATCH_SIZE).train(reference, generatePatterns(), NUM_OF_EPOCHS, STEP_SIZE);
+    
+    const vector<double> weights = reference.getWeights();
+    double maxDifference = 0;
+    for (int i = 0; i < weights.size(); i++)
+    {
+        maxDifference = max(maxDifference, fabs(weights[i] - result.weights[i]));
+    }
+    
+    cout << numOfWorkers << " workers (" << transportType << "), max weight difference: " << maxDifference << endl;
+    if (maxDifference > TOLERANCE)
+    {
+        cout << "FAILED" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "DataParallelTrainer.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace NeNet
+{
+
+DataParallelTrainer::DataParallelTrainer(AllreduceTransport& transport, const int globalBatchSize) :
+    _transport(transport),
+    _globalBatchSize(max(1, globalBatchSize))
+{
+}
+
+bool DataParallelTrainer::train(NeuralNetwork& network,
+                                const vector<pair<vector<double>, double>>& patterns,
+                                const int numOfEpochs,
+                                const double stepSize)
+{
+    const int rank = _transport.getRank();
+    const int numOfWorkers = _transport.getNumOfWorkers();
+    const size_t numOfWeights = network.getEdges().size();
+    
+    /* Gradients of all weights followed by sum of errors, reduced together */
+    vector<double> gradients(numOfWeights + 1);
+    
+    for (int i = 0; i < numOfEpochs; i++)
+    {
+        double error = 0;
+        for (int start = 0; start < patterns.size(); start += _globalBatchSize)
+        {
+            const int batchSize = min((int)patterns.size() - start, _globalBatchSize);
+            const int shardBegin = start + batchSize * rank / numOfWorkers;
+            const int shardEnd = start + batchSize * (rank + 1) / numOfWorkers;
+            
+            fill(gradients.begin(), gradients.end(), 0);
+            double shardError = 0;
+            for (int p = shardBegin; p < shardEnd; p++)
+            {
+                shardError += network.addGradient(patterns[p].first, patterns[p].second, gradients);
+            }
+            gradients[numOfWeights] = shardError;
+            
+            if (!ringAllreduce(_transport, gradients.data(), gradients.size()))
+            {
+                return false;
+            }
+            
+            error += gradients[numOfWeights];
+            for (size_t w = 0; w < numOfWeights; w++)
+            {
+                gradients[w] /= batchSize;
+            }
+            network.applyGradient(gradients, stepSize);
+        }
+        
+        if (rank == 0)
+        {
+            cout << i << ": " << error / patterns.size() << endl;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma  once
+
+#include "AllreduceTransport.h"
+#include "NeuralNetwork.h"
+
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Data-parallel mini-batch training across worker processes.
+ *
+ * Every worker runs the same training with the same patterns and the same
+ * initial weights. Each global mini-batch is split into contiguous shards,
+ * every worker computes gradient of its shard, the gradients are summed
+ * by ring allreduce and all workers apply the same update
+ * (weight -= sum of gradients / size of mini-batch * stepSize),
+ * so the weights stay identical on all of them.
+ */
+class DataParallelTrainer
+{
+private:
+    AllreduceTransport& _transport;
+    const int _globalBatchSize;
+    
+public:
+    DataParallelTrainer(AllreduceTransport& transport, const int globalBatchSize);
+    
+    /**
+     * Trains weights currently set in the network (initialize them first,
+     * with the same seed on all workers). Progress is printed by worker 0 only.
+     * Returns false if the transport failed, training then stops
+     * and weights of the network are undefined.
+     */
+    bool train(NeuralNetwork& network,
+               const std::vector<std::pair<std::vector<double>, double>>& patterns,
+               const int numOfEpochs,
+               const double stepSize);
+};
+
+}
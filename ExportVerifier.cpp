@@ -0,0 +1,174 @@
+//
+//  Verifier of the exported C++ code.
+//
+//  Trains a sigmoid and a softmax network, exports each of them by exportToCpp,
+//  compiles a small program including the generated header and checks
+//  that its outputs match NeuralNetwork::use on random inputs.
+//
+//  Usage: ExportVerifier [compiler]
+//  (compiler defaults to $CXX or c++)
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "CodeExporter.h"
+#include "NeuralNetwork.h"
+
+using namespace std;
+using namespace NeNet;
+
+static const unsigned int SEED = 42;
+static const int NUM_OF_PATTERNS = 500;
+static const int NUM_OF_EPOCHS = 50;
+static const int NUM_OF_TEST_INPUTS = 1000;
+static const double TOLERANCE = 1e-12;
+
+/**
+ * Torus from main.cpp (class 1 inside, 0 outside), or three classes
+ * by distance from the centre if numOfClasses is 3.
+ */
+static vector<pair<vector<double>, double>> generatePatterns(const int numOfClasses)
+{
+    mt19937 generator(SEED);
+    uniform_real_distribution<double> distribution(0, 1);
+    
+    vector<pair<vector<double>, double>> patterns;
+    for (int i = 0; i < NUM_OF_PATTERNS; i++)
+    {
+        const double x = distribution(generator);
+        const double y = distribution(generator);
+        const double distance = sqrt(pow(x - 0.5, 2) + pow(y - 0.5, 2));
+        const double output = numOfClasses == 3 ? (distance <= 0.2 ? 0 : distance <= 0.4 ? 1 : 2)
+                                                : (distance <= 0.3 ? 1 : 0);
+        patterns.push_back(make_pair(vector<double>{x, y}, output));
+    }
+    return patterns;
+}
+
+/**
+ * Exports the network, compiles program using the header and compares its outputs
+ * with outputs of the network. Returns false if compilation fails or outputs differ.
+ */
+static bool verify(NeuralNetwork& network, const string& name, const string& compiler)
+{
+    const string basePath = "/tmp/NeNet-export-" + to_string(getpid()) + "-" + name;
+    const string headerPath = basePath + ".h";
+    const string sourcePath = basePath + ".cpp";
+    const string programPath = basePath;
+    const string inputsPath = basePath + ".in";
+    const string outputsPath = basePath + ".out";
+    
+    if (!exportToCpp(network, name, headerPath))
+    {
+        cerr << "Exporting " << name << " failed" << endl;
+        return false;
+    }
+    
+    /* Program reading inputs as hexadecimal floats and writing outputs the same way */
+    ofstream source(sourcePath);
+    source << "#include \"" << headerPath << "\"\n"
+           << "#include <cstdio>\n"
+           << "int main()\n"
+           << "{\n"
+           << "    double input[" << name << "::NUM_OF_INPUTS];\n"
+           << "    double output[" << name << "::NUM_OF_OUTPUTS];\n"
+           << "    for (;;)\n"
+           << "    {\n"
+           << "        for (int i = 0; i < " << name << "::NUM_OF_INPUTS; i++)\n"
+           << "        {\n"
+           << "            if (std::scanf(\"%la\", &input[i]) != 1) return 0;\n"
+           << "        }\n"
+           << "        " << name << "::use(input, output);\n"
+           << "        for (int i = 0; i < " << name << "::NUM_OF_OUTPUTS; i++)\n"
+           << "        {\n"
+           << "            std::printf(\"%a\\n\", output[i]);\n"
+           << "        }\n"
+           << "    }\n"
+           << "}\n";
+    source.close();
+    
+    const string command = compiler + " -std=c++11 -O2 " + sourcePath + " -o " + programPath;
+    if (!source || system(command.c_str()) != 0)
+    {
+        cerr << "Compiling " << name << " failed" << endl;
+        return false;
+    }
+    
+    mt19937 generator(SEED + 1);
+    uniform_real_distribution<double> distribution(-0.5, 1.5);
+    vector<vector<double>> inputs;
+    FILE* inputsFile = fopen(inputsPath.c_str(), "w");
+    for (int i = 0; i < NUM_OF_TEST_INPUTS; i++)
+    {
+        inputs.push_back({distribution(generator), distribution(generator)});
+        fprintf(inputsFile, "%a %a\n", inputs.back()[0], inputs.back()[1]);
+    }
+    fclose(inputsFile);
+    
+    const string runCommand = programPath + " < " + inputsPath + " > " + outputsPath;
+    if (system(runCommand.c_str()) != 0)
+    {
+        cerr << "Running " << name << " failed" << endl;
+        return false;
+    }
+    
+    FILE* outputsFile = fopen(outputsPath.c_str(), "r");
+    double maxDifference = 0;
+    bool isComplete = true;
+    for (const auto& input : inputs)
+    {
+        for (const double expected : network.use(input))
+        {
+            double exported;
+            if (fscanf(outputsFile, "%la", &exported) != 1)
+            {
+                isComplete = false;
+                break;
+            }
+            maxDifference = max(maxDifference, fabs(exported - expected));
+        }
+    }
+    fclose(outputsFile);
+    
+    for (const auto& path : {headerPath, sourcePath, programPath, inputsPath, outputsPath})
+    {
+        unlink(path.c_str());
+    }
+    
+    cout << name << ": max output difference: " << maxDifference << endl;
+    return isComplete && maxDifference <= TOLERANCE;
+}
+
+int main(int argc, const char *argv[])
+{
+    const char* defaultCompiler = getenv("CXX");
+    const string compiler = argc > 1 ? argv[1] : defaultCompiler ? defaultCompiler : "c++";
+    
+    NeuralNetwork sigmoidNetwork(2, {7, 1});
+    sigmoidNetwork.setSeed(SEED);
+    sigmoidNetwork.train(generatePatterns(2), NUM_OF_EPOCHS, 0, 1, 1.0);
+    
+    NeuralNetwork softmaxNetwork(2, {8, 3});
+    softmaxNetwork.setSeed(SEED);
+    softmaxNetwork.setLossFunction(CROSS_ENTROPY);
+    softmaxNetwork.train(generatePatterns(3), NUM_OF_EPOCHS, 0, 1, 0.5);
+    
+    const bool isSigmoidOk = verify(sigmoidNetwork, "SigmoidNetwork", compiler);
+    const bool isSoftmaxOk = verify(softmaxNetwork, "SoftmaxNetwork", compiler);
+    if (!isSigmoidOk || !isSoftmaxOk)
+    {
+        cout << "FAILED" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,154 @@
+#pragma  once
+
+#include "Activation.h"
+#include "NeuralNetwork.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace NeNet
+{
+
+namespace FixedNetworkDetail
+{
+
+constexpr int numOfWeights(const int numOfInputs)
+{
+    return 0;
+}
+
+template<typename... Sizes>
+constexpr int numOfWeights(const int numOfInputs, const int layerSize, const Sizes... rest)
+{
+    return (numOfInputs + 1) * layerSize + numOfWeights(layerSize, rest...);
+}
+
+constexpr int lastOf(const int size)
+{
+    return size;
+}
+
+template<typename... Sizes>
+constexpr int lastOf(const int size, const Sizes... rest)
+{
+    return lastOf(rest...);
+}
+
+/**
+ * Forward propagation through layers with compile-time sizes.
+ * Offset is position of the first weight of the layer in the array of all weights.
+ */
+template<int Offset, int NumOfInputs, int... LayerSizes>
+struct Layers;
+
+template<int Offset, int NumOfInputs>
+struct Layers<Offset, NumOfInputs>
+{
+    template<size_t NumOfWeights>
+    static std::array<double, NumOfInputs> propagate(const std::array<double, NumOfWeights>& weights,
+                                                     const std::array<double, NumOfInputs>& input)
+    {
+        return input;
+    }
+};
+
+template<int Offset, int NumOfInputs, int LayerSize, int... Rest>
+struct Layers<Offset, NumOfInputs, LayerSize, Rest...>
+{
+    template<size_t NumOfWeights>
+    static auto propagate(const std::array<double, NumOfWeights>& weights,
+                          const std::array<double, NumOfInputs>& input)
+    {
+        std::array<double, LayerSize> output;
+        computeLayerOutputs(weights.data() + Offset, input.data(), NumOfInputs, LayerSize, false, output.data());
+        
+        return Layers<Offset + (NumOfInputs + 1) * LayerSize, LayerSize, Rest...>::propagate(weights, output);
+    }
+};
+
+}
+
+/**
+ * Network with topology fixed at compile time, e.g. FixedNetwork<2, 7, 1>
+ * has 2 inputs, 7 perceptrons in the first and 1 in the output layer.
+ *
+ * Weights are stored in one std::array (in order of NeuralNetwork::getEdges()),
+ * all loops have constant bounds, so tiny networks are fully unrolled and evaluated
+ * without any allocation. Computes the same outputs as NeuralNetwork::use.
+ * Intended for inference only, train NeuralNetwork and copy weights over.
+ */
+template<int NumOfInputs, int... NumsOfPerceptrons>
+class FixedNetwork
+{
+public:
+    static constexpr int NUM_OF_INPUTS = NumOfInputs;
+    static constexpr int NUM_OF_LAYERS = sizeof...(NumsOfPerceptrons);
+    static constexpr int NUM_OF_OUTPUTS = FixedNetworkDetail::lastOf(NumsOfPerceptrons...);
+    static constexpr int NUM_OF_WEIGHTS = FixedNetworkDetail::numOfWeights(NumOfInputs, NumsOfPerceptrons...);
+    
+    typedef std::array<double, NUM_OF_INPUTS> Input;
+    typedef std::array<double, NUM_OF_OUTPUTS> Output;
+    typedef std::array<double, NUM_OF_WEIGHTS> Weights;
+    
+private:
+    Weights _weights;
+    
+public:
+    constexpr FixedNetwork() : _weights() {}
+    
+    constexpr explicit FixedNetwork(const Weights& weights) : _weights(weights) {}
+    
+    constexpr const Weights& getWeights() const { return _weights; }
+    
+    /**
+     * Returns true if the network has the same topology.
+     */
+    static bool hasTopologyOf(NeuralNetwork& network)
+    {
+        return network.getNumOfInputs() == NUM_OF_INPUTS &&
+               network.getNumsOfPerceptrons() == std::vector<int>{NumsOfPerceptrons...};
+    }
+    
+    /**
+     * Copies weights from dynamic network.
+     * Returns false if topologies differ or the network has softmax output (not supported).
+     */
+    bool copyWeightsFrom(NeuralNetwork& network)
+    {
+        if (!hasTopologyOf(network) || network.hasSoftmaxOutput())
+        {
+            return false;
+        }
+        
+        const std::vector<double> weights = network.getWeights();
+        std::copy(weights.begin(), weights.end(), _weights.begin());
+        return true;
+    }
+    
+    /**
+     * Copies weights to dynamic network. Returns false if topologies differ.
+     */
+    bool copyWeightsTo(NeuralNetwork& network) const
+    {
+        if (!hasTopologyOf(network))
+        {
+            return false;
+        }
+        
+        network.setWeights(std::vector<double>(_weights.begin(), _weights.end()));
+        return true;
+    }
+    
+    Output use(const Input& input) const
+    {
+        return FixedNetworkDetail::Layers<0, NumOfInputs, NumsOfPerceptrons...>::propagate(_weights, input);
+    }
+    
+    double useForSingleOutput(const Input& input) const
+    {
+        return use(input)[0];
+    }
+};
+
+}
@@ -0,0 +1,182 @@
+#include "HyperparameterSweep.h"
+#include "NeuralNetwork.h"
+#include "StackedNetworks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace NeNet
+{
+
+HyperparameterSweep::HyperparameterSweep(const int numOfInputs,
+                                         const int numOfEpochs,
+                                         const bool decreaseLearningRate,
+                                         const double minStepSize) :
+    _numOfInputs(numOfInputs),
+    _numOfEpochs(numOfEpochs),
+    _decreaseLearningRate(decreaseLearningRate),
+    _minStepSize(minStepSize)
+{
+}
+
+void HyperparameterSweep::addGrid(const vector<vector<int>>& topologies,
+                                  const vector<double>& stepSizes,
+                                  const vector<pair<double, double>>& initRanges,
+                                  const vector<unsigned int>& seeds)
+{
+    for (const auto& topology : topologies)
+    {
+        for (const auto stepSize : stepSizes)
+        {
+            for (const auto& initRange : initRanges)
+            {
+                for (const auto seed : seeds)
+                {
+                    addConfiguration({topology, stepSize, initRange.first, initRange.second, seed});
+                }
+            }
+        }
+    }
+}
+
+void HyperparameterSweep::trainStack(const vector<int>& stack,
+                                     const vector<pair<vector<double>, double>>& trainingPatterns,
+                                     const vector<pair<vector<double>, double>>& validationPatterns,
+                                     vector<SweepResult>& results)
+{
+    const auto& numsOfPerceptrons = _configurations[stack[0]].numsOfPerceptrons;
+    StackedNetworks networks(_numOfInputs, numsOfPerceptrons, (int)stack.size());
+    
+    /* Initial weights are the same as NeuralNetwork would use (generated without building it,
+       as constructing NeuralNetwork is not thread-safe) */
+    vector<double> stepSizeDecreases;
+    for (int k = 0; k < stack.size(); k++)
+    {
+        const auto& configuration = _configurations[stack[k]];
+        networks.setWeights(k, NeuralNetwork::generateWeights(_numOfInputs, numsOfPerceptrons, configuration.seed,
+                                                              configuration.lowerBound, configuration.upperBound));
+        networks.setStepSize(k, configuration.stepSize);
+        stepSizeDecreases.push_back((configuration.stepSize - _minStepSize) / _numOfEpochs);
+    }
+    
+    vector<double> errors(stack.size(), 0);
+    for (int epoch = 0; epoch < _numOfEpochs; epoch++)
+    {
+        fill(errors.begin(), errors.end(), 0);
+        for (const auto& pattern : trainingPatterns)
+        {
+            networks.trainOnPattern(pattern.first, pattern.second, errors);
+        }
+        
+        if (_decreaseLearningRate)
+        {
+            for (int k = 0; k < stack.size(); k++)
+            {
+                networks.setStepSize(k, networks.getStepSize(k) - stepSizeDecreases[k]);
+            }
+        }
+    }
+    
+    vector<double> validationErrors(stack.size(), 0);
+    for (const auto& pattern : validationPatterns)
+    {
+        networks.addErrors(pattern.first, pattern.second, validationErrors);
+    }
+    
+    for (int k = 0; k < stack.size(); k++)
+    {
+        auto& result = results[stack[k]];
+        result.configuration = _configurations[stack[k]];
+        result.trainingError = trainingPatterns.empty() ? 0 : errors[k] / trainingPatterns.size();
+        result.validationError = validationPatterns.empty() ?
+            result.trainingError :
+            validationErrors[k] / validationPatterns.size();
+        result.weights = networks.getWeights(k);
+    }
+}
+
+vector<SweepResult> HyperparameterSweep::run(const vector<pair<vector<double>, double>>& trainingPatterns,
+                                             const vector<pair<vector<double>, double>>& validationPatterns,
+                                             int numOfThreads)
+{
+    /* Packing configurations of the same topology into stacks */
+    map<vector<int>, vector<int>> topologies;
+    for (int i = 0; i < _configurations.size(); i++)
+    {
+        topologies[_configurations[i].numsOfPerceptrons].push_back(i);
+    }
+    
+    vector<vector<int>> stacks;
+    for (const auto& topology : topologies)
+    {
+        const auto& indices = topology.second;
+        for (int i = 0; i < indices.size(); i += MAX_NUM_OF_STACKED_NETWORKS)
+        {
+            const int end = min((int)indices.size(), i + MAX_NUM_OF_STACKED_NETWORKS);
+            stacks.push_back(vector<int>(indices.begin() + i, indices.begin() + end));
+        }
+    }
+    
+    /* Scheduling the stacks over the pool of threads */
+    if (numOfThreads <= 0)
+    {
+        numOfThreads = max(1, (int)thread::hardware_concurrency());
+    }
+    numOfThreads = min(numOfThreads, max(1, (int)stacks.size()));
+    
+    vector<SweepResult> results(_configurations.size());
+    atomic<int> nextStack(0);
+    vector<thread> threads;
+    for (int t = 0; t < numOfThreads; t++)
+    {
+        threads.push_back(thread([&] {
+            for (int s = nextStack++; s < stacks.size(); s = nextStack++)
+            {
+                trainStack(stacks[s], trainingPatterns, validationPatterns, results);
+            }
+        }));
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    
+    stable_sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        return a.validationError < b.validationError;
+    });
+    return results;
+}
+
+void HyperparameterSweep::printLeaderboard(const vector<SweepResult>& results,
+                                           ostream& out,
+                                           const int numOfRows)
+{
+    out << "-----LEADERBOARD-----\n";
+    out << setw(4) << "#" << setw(16) << "topology" << setw(10) << "step"
+        << setw(16) << "init range" << setw(12) << "seed"
+        << setw(14) << "train error" << setw(14) << "valid error" << endl;
+    
+    for (int i = 0; i < min(numOfRows, (int)results.size()); i++)
+    {
+        const auto& configuration = results[i].configuration;
+        stringstream topology;
+        for (int j = 0; j < configuration.numsOfPerceptrons.size(); j++)
+        {
+            topology << (j == 0 ? "" : "-") << configuration.numsOfPerceptrons[j];
+        }
+        stringstream initRange;
+        initRange << "[" << configuration.lowerBound << ", " << configuration.upperBound << "]";
+        
+        out << setw(4) << i + 1 << setw(16) << topology.str() << setw(10) << configuration.stepSize
+            << setw(16) << initRange.str() << setw(12) << configuration.seed
+            << setw(14) << results[i].trainingError << setw(14) << results[i].validationError << endl;
+    }
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma  once
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * One point of the hyperparameter grid.
+ */
+struct SweepConfiguration
+{
+    std::vector<int> numsOfPerceptrons;
+    double stepSize;
+    double lowerBound; // range of initial weights
+    double upperBound;
+    unsigned int seed; // seed for initial weights
+};
+
+struct SweepResult
+{
+    SweepConfiguration configuration;
+    double trainingError; // mean squared error in the last epoch
+    double validationError; // mean squared error on validation patterns (training error if there are none)
+    std::vector<double> weights; // trained weights, usable with NeuralNetwork::setWeights
+};
+
+/**
+ * Trains many small networks with different hyperparameters at once.
+ *
+ * Configurations with the same topology are packed into StackedNetworks
+ * (up to MAX_NUM_OF_STACKED_NETWORKS of them) and trained in lockstep,
+ * the stacks are distributed over a pool of threads.
+ */
+class HyperparameterSweep
+{
+private:
+    static const int MAX_NUM_OF_STACKED_NETWORKS = 8;
+    
+    const int _numOfInputs;
+    const int _numOfEpochs;
+    const bool _decreaseLearningRate;
+    const double _minStepSize;
+    
+    std::vector<SweepConfiguration> _configurations;
+    
+    /**
+     * Trains configurations with given indices (all of the same topology) in lockstep.
+     */
+    void trainStack(const std::vector<int>& stack,
+                    const std::vector<std::pair<std::vector<double>, double>>& trainingPatterns,
+                    const std::vector<std::pair<std::vector<double>, double>>& validationPatterns,
+                    std::vector<SweepResult>& results);
+    
+public:
+    /**
+     * Training parameters shared by all configurations have the same meaning
+     * as in NeuralNetwork::train.
+     */
+    HyperparameterSweep(const int numOfInputs,
+                        const int numOfEpochs,
+                        const bool decreaseLearningRate = false,
+                        const double minStepSize = 0.01);
+    
+    void addConfiguration(const SweepConfiguration& configuration) {
+        _configurations.push_back(configuration);
+    }
+    
+    /**
+     * Adds all combinations of given hyperparameters.
+     */
+    void addGrid(const std::vector<std::vector<int>>& topologies,
+                 const std::vector<double>& stepSizes,
+                 const std::vector<std::pair<double, double>>& initRanges,
+                 const std::vector<unsigned int>& seeds);
+    
+    /**
+     * Trains all configurations and returns results sorted from the best
+     * (lowest validation error). numOfThreads == 0 means number of hardware threads.
+     */
+    std::vector<SweepResult> run(const std::vector<std::pair<std::vector<double>, double>>& trainingPatterns,
+                                 const std::vector<std::pair<std::vector<double>, double>>& validationPatterns,
+                                 int numOfThreads = 0);
+    
+    /**
+     * Prints best numOfRows results.
+     */
+    static void printLeaderboard(const std::vector<SweepResult>& results,
+                                 std::ostream& out = std::cout,
+                                 const int numOfRows = 10);
+};
+
+}
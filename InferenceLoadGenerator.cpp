@@ -0,0 +1,107 @@
+//
+//  Local load generator for the inference server.
+//
+//  Starts N client threads, each submitting single-sample requests to one
+//  InferenceServer (waiting for each result before the next submit), checks
+//  the results against NeuralNetwork::use and prints the statistics of the server:
+//  queue depth, batch-size histogram and latency percentiles.
+//
+//  Usage: InferenceLoadGenerator [numOfClients] [requestsPerClient] [maxBatchSize] [maxWaitMicroseconds]
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "InferenceServer.h"
+#include "NeuralNetwork.h"
+
+using namespace std;
+using namespace NeNet;
+
+static const unsigned int SEED = 42;
+static const int NUM_OF_INPUTS = 16;
+static const vector<int> NUMS_OF_PERCEPTRONS = {64, 64, 1};
+
+int main(int argc, const char *argv[])
+{
+    const int numOfClients = argc > 1 ? max(1, atoi(argv[1])) : 8;
+    const int requestsPerClient = argc > 2 ? max(1, atoi(argv[2])) : 10000;
+    const int maxBatchSize = argc > 3 ? max(1, atoi(argv[3])) : 64;
+    const int maxWait = argc > 4 ? max(0, atoi(argv[4])) : 1000;
+    
+    NeuralNetwork network(NUM_OF_INPUTS, NUMS_OF_PERCEPTRONS);
+    network.setSeed(SEED);
+    network.initializeWeights(-1, 1);
+    
+    /* Inputs and expected outputs computed before the server takes the network over */
+    mt19937 generator(SEED);
+    uniform_real_distribution<double> distribution(0, 1);
+    vector<vector<double>> inputs(requestsPerClient, vector<double>(NUM_OF_INPUTS));
+    vector<vector<double>> expectedOutputs;
+    for (auto& input : inputs)
+    {
+        for (auto& value : input)
+        {
+            value = distribution(generator);
+        }
+        expectedOutputs.push_back(network.use(input));
+    }
+    
+    InferenceServer server(network, maxBatchSize, chrono::microseconds(maxWait));
+    
+    const auto start = chrono::steady_clock::now();
+    vector<int> numsOfWrongOutputs(numOfClients, 0);
+    vector<thread> clients;
+    for (int c = 0; c < numOfClients; c++)
+    {
+        clients.emplace_back([&, c] {
+            for (int i = 0; i < requestsPerClient; i++)
+            {
+                const int r = (i + c) % requestsPerClient;
+                if (server.submit(inputs[r]).get() != expectedOutputs[r])
+                {
+                    numsOfWrongOutputs[c]++;
+                }
+            }
+        });
+    }
+    for (auto& client : clients)
+    {
+        client.join();
+    }
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    const InferenceStatistics statistics = server.getStatistics();
+    
+    cout << numOfClients << " clients, " << statistics.numOfRequests << " requests in "
+         << statistics.numOfBatches << " batches, " << (long)(statistics.numOfRequests / seconds) << " requests/sec\n";
+    cout << "Queue depth: " << statistics.queueDepth << " (max " << statistics.maxQueueDepth << ")\n";
+    cout << "Batch sizes:\n";
+    for (int size = 1; size < statistics.batchSizeHistogram.size(); size++)
+    {
+        if (statistics.batchSizeHistogram[size] > 0)
+        {
+            cout << "  " << size << ": " << statistics.batchSizeHistogram[size] << "\n";
+        }
+    }
+    cout << "Latency (us): p50 " << statistics.latencyP50
+         << ", p90 " << statistics.latencyP90
+         << ", p99 " << statistics.latencyP99 << endl;
+    
+    int numOfWrongOutputs = 0;
+    for (const auto number : numsOfWrongOutputs)
+    {
+        numOfWrongOutputs += number;
+    }
+    if (numOfWrongOutputs > 0 || statistics.numOfRequests != (long)numOfClients * requestsPerClient)
+    {
+        cout << "FAILED (" << numOfWrongOutputs << " wrong outputs)" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
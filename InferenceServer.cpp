@@ -0,0 +1,146 @@
+#include "InferenceServer.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace NeNet
+{
+
+InferenceServer::InferenceServer(NeuralNetwork& network,
+                                 const int maxBatchSize,
+                                 const chrono::microseconds maxWait) :
+    _network(network),
+    _maxBatchSize(max(1, maxBatchSize)),
+    _maxWait(maxWait),
+    _stop(false),
+    _numOfRequests(0),
+    _numOfBatches(0),
+    _maxQueueDepth(0),
+    _batchSizeHistogram(_maxBatchSize + 1, 0)
+{
+    _thread = thread(&InferenceServer::run, this);
+}
+
+InferenceServer::~InferenceServer()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+}
+
+future<vector<double>> InferenceServer::submit(vector<double> input)
+{
+    /* Input of wrong size is answered right away and never reaches the batch */
+    if (input.size() != _network.getNumOfInputs())
+    {
+        promise<vector<double>> rejected;
+        rejected.set_value(vector<double>());
+        return rejected.get_future();
+    }
+    
+    Request request;
+    request.input = move(input);
+    request.arrival = Clock::now();
+    future<vector<double>> result = request.promise.get_future();
+    
+    bool isBatchFull;
+    {
+        lock_guard<mutex> lock(_mutex);
+        _queue.push_back(move(request));
+        _maxQueueDepth = max(_maxQueueDepth, (int)_queue.size());
+        isBatchFull = _queue.size() == 1 || _queue.size() >= _maxBatchSize;
+    }
+    
+    /* Batching thread needs to know only about the first request (to start the timer) and a full batch */
+    if (isBatchFull)
+    {
+        _condition.notify_all();
+    }
+    return result;
+}
+
+void InferenceServer::run()
+{
+    vector<Request> batch;
+    vector<vector<double>> inputs;
+    
+    unique_lock<mutex> lock(_mutex);
+    while (true)
+    {
+        _condition.wait(lock, [this] { return !_queue.empty() || _stop; });
+        if (_queue.empty())
+        {
+            return;
+        }
+        
+        /* Waiting for full batch, at most until the oldest request is due */
+        const Clock::time_point deadline = _queue.front().arrival + _maxWait;
+        _condition.wait_until(lock, deadline, [this] { return _queue.size() >= _maxBatchSize || _stop; });
+        
+        const int batchSize = min((int)_queue.size(), _maxBatchSize);
+        for (int i = 0; i < batchSize; i++)
+        {
+            inputs.push_back(move(_queue.front().input));
+            batch.push_back(move(_queue.front()));
+            _queue.pop_front();
+        }
+        lock.unlock();
+        
+        const vector<vector<double>> outputs = _network.useBatch(inputs);
+        
+        /* Statistics first, so that a caller which got all its results sees them counted */
+        const Clock::time_point now = Clock::now();
+        lock.lock();
+        for (int i = 0; i < batchSize; i++)
+        {
+            const double latency = chrono::duration<double, micro>(now - batch[i].arrival).count();
+            if (_latencies.size() < NUM_OF_RECORDED_LATENCIES) {
+                _latencies.push_back(latency);
+            } else {
+                _latencies[_numOfRequests % NUM_OF_RECORDED_LATENCIES] = latency;
+            }
+            _numOfRequests++;
+        }
+        _numOfBatches++;
+        _batchSizeHistogram[batchSize]++;
+        lock.unlock();
+        
+        for (int i = 0; i < batchSize; i++)
+        {
+            batch[i].promise.set_value(outputs[i]);
+        }
+        batch.clear();
+        inputs.clear();
+        
+        lock.lock();
+    }
+}
+
+InferenceStatistics InferenceServer::getStatistics()
+{
+    lock_guard<mutex> lock(_mutex);
+    
+    InferenceStatistics statistics;
+    statistics.numOfRequests = _numOfRequests;
+    statistics.numOfBatches = _numOfBatches;
+    statistics.queueDepth = (int)_queue.size();
+    statistics.maxQueueDepth = _maxQueueDepth;
+    statistics.batchSizeHistogram = _batchSizeHistogram;
+    
+    vector<double> latencies = _latencies;
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies.empty() ? 0 : latencies[(size_t)(p * (latencies.size() - 1))];
+    };
+    statistics.latencyP50 = percentile(0.5);
+    statistics.latencyP90 = percentile(0.9);
+    statistics.latencyP99 = percentile(0.99);
+    
+    return statistics;
+}
+
+}
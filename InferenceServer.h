@@ -0,0 +1,92 @@
+#pragma  once
+
+#include "NeuralNetwork.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NeNet
+{
+
+struct InferenceStatistics
+{
+    long numOfRequests; // completed requests
+    long numOfBatches;
+    int queueDepth; // requests waiting at the moment
+    int maxQueueDepth;
+    std::vector<long> batchSizeHistogram; // number of batches of each size (index is the size)
+    
+    /* Percentiles of time from submit to completion (over recent requests), in microseconds */
+    double latencyP50;
+    double latencyP90;
+    double latencyP99;
+};
+
+/**
+ * In-process inference server coalescing single-sample requests into batches.
+ *
+ * Any number of threads may submit inputs. One batching thread waits until
+ * maxBatchSize requests are queued or the oldest request waited maxWait,
+ * evaluates them all by one NeuralNetwork::useBatch and fulfils the futures.
+ * The network must not be used by anyone else while the server is running.
+ */
+class InferenceServer
+{
+private:
+    static const int NUM_OF_RECORDED_LATENCIES = 10000;
+    
+    typedef std::chrono::steady_clock Clock;
+    
+    struct Request
+    {
+        std::vector<double> input;
+        std::promise<std::vector<double>> promise;
+        Clock::time_point arrival;
+    };
+    
+    NeuralNetwork& _network;
+    const int _maxBatchSize;
+    const std::chrono::microseconds _maxWait;
+    
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<Request> _queue;
+    bool _stop;
+    
+    /* Statistics, guarded by _mutex */
+    long _numOfRequests;
+    long _numOfBatches;
+    int _maxQueueDepth;
+    std::vector<long> _batchSizeHistogram;
+    std::vector<double> _latencies; // ring buffer of the last NUM_OF_RECORDED_LATENCIES latencies
+    
+    std::thread _thread;
+    
+    void run();
+    
+public:
+    InferenceServer(NeuralNetwork& network,
+                    const int maxBatchSize = 64,
+                    const std::chrono::microseconds maxWait = std::chrono::microseconds(1000));
+    
+    /**
+     * Evaluates requests still in the queue and stops the batching thread.
+     */
+    ~InferenceServer();
+    
+    /**
+     * Queues the input, the future is fulfilled with output of the network.
+     * Input which does not have NeuralNetwork::getNumOfInputs() values is not queued,
+     * the returned future holds empty output right away.
+     */
+    std::future<std::vector<double>> submit(std::vector<double> input);
+    
+    InferenceStatistics getStatistics();
+};
+
+}
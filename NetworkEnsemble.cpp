@@ -0,0 +1,170 @@
+#include "NetworkEnsemble.h"
+#include "Activation.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace NeNet
+{
+
+NetworkEnsemble::NetworkEnsemble() :
+    _numOfInputs(0),
+    _numOfOutputs(0),
+    _firstLayerWidth(0)
+{
+}
+
+bool NetworkEnsemble::addMember(NeuralNetwork& network, const double weight)
+{
+    const vector<int> numsOfPerceptrons = network.getNumsOfPerceptrons();
+    if (!_members.empty() &&
+        (network.getNumOfInputs() != _numOfInputs || numsOfPerceptrons.back() != _numOfOutputs))
+    {
+        return false;
+    }
+    _numOfInputs = network.getNumOfInputs();
+    _numOfOutputs = numsOfPerceptrons.back();
+    
+    Member member;
+    member.numsOfPerceptrons = numsOfPerceptrons;
+    member.firstLayerOffset = _firstLayerWidth;
+    member.weight = weight;
+    member.hasSoftmaxOutput = network.hasSoftmaxOutput();
+    
+    /* Splitting weights to layers */
+    const vector<double> weights = network.getWeights();
+    auto edge = weights.begin();
+    vector<double> firstLayerWeights(edge, edge + (_numOfInputs + 1) * numsOfPerceptrons[0]);
+    edge += firstLayerWeights.size();
+    for (int layer = 1; layer < numsOfPerceptrons.size(); layer++)
+    {
+        const int numOfLayerWeights = (numsOfPerceptrons[layer - 1] + 1) * numsOfPerceptrons[layer];
+        member.weights.push_back(vector<double>(edge, edge + numOfLayerWeights));
+        member.outputs.push_back(vector<double>(numsOfPerceptrons[layer], 0));
+        edge += numOfLayerWeights;
+    }
+    
+    /* Appending member's first layer to the fused layer */
+    const int memberWidth = numsOfPerceptrons[0];
+    const int width = _firstLayerWidth + memberWidth;
+    vector<double> fusedWeights((_numOfInputs + 1) * width);
+    for (int from = -1; from < _numOfInputs; from++)
+    {
+        copy(_firstLayerWeights.begin() + (from + 1) * _firstLayerWidth,
+             _firstLayerWeights.begin() + (from + 2) * _firstLayerWidth,
+             fusedWeights.begin() + (from + 1) * width);
+        copy(firstLayerWeights.begin() + (from + 1) * memberWidth,
+             firstLayerWeights.begin() + (from + 2) * memberWidth,
+             fusedWeights.begin() + (from + 1) * width + _firstLayerWidth);
+    }
+    _firstLayerWeights = fusedWeights;
+    _firstLayerWidth = width;
+    _firstLayerOutputs.resize(width);
+    
+    _members.push_back(member);
+    _memberOutputs.resize(_members.size() * _numOfOutputs);
+    _scratch.resize(_members.size());
+    return true;
+}
+
+void NetworkEnsemble::forwardPropagate(const vector<double>& input)
+{
+    /* Fused first layer */
+    computeLayerOutputs(_firstLayerWeights.data(), input.data(), _numOfInputs, _firstLayerWidth,
+                        false, _firstLayerOutputs.data());
+    
+    /* Remaining layers of individual members */
+    for (int m = 0; m < _members.size(); m++)
+    {
+        Member& member = _members[m];
+        const double* values = _firstLayerOutputs.data() + member.firstLayerOffset;
+        for (int layer = 1; layer < member.numsOfPerceptrons.size(); layer++)
+        {
+            const int numOfLayerInputs = member.numsOfPerceptrons[layer - 1];
+            const int layerSize = member.numsOfPerceptrons[layer];
+            const bool isSoftmax = member.hasSoftmaxOutput && layer == member.numsOfPerceptrons.size() - 1;
+            double* outputs = member.outputs[layer - 1].data();
+            computeLayerOutputs(member.weights[layer - 1].data(), values, numOfLayerInputs, layerSize, isSoftmax, outputs);
+            values = outputs;
+        }
+        
+        copy(values, values + _numOfOutputs, _memberOutputs.begin() + m * _numOfOutputs);
+    }
+}
+
+vector<double> NetworkEnsemble::use(const vector<double>& input, const EnsembleReduction reduction)
+{
+    if (_members.empty())
+    {
+        return vector<double>();
+    }
+    
+    forwardPropagate(input);
+    
+    const int numOfMembers = (int)_members.size();
+    vector<double> output(_numOfOutputs, 0);
+    for (int o = 0; o < _numOfOutputs; o++)
+    {
+        switch (reduction)
+        {
+            case MEAN:
+            {
+                for (int m = 0; m < numOfMembers; m++)
+                {
+                    output[o] += _memberOutputs[m * _numOfOutputs + o];
+                }
+                output[o] /= numOfMembers;
+                break;
+            }
+            case WEIGHTED_MEAN:
+            {
+                double sumOfWeights = 0;
+                for (int m = 0; m < numOfMembers; m++)
+                {
+                    output[o] += _members[m].weight * _memberOutputs[m * _numOfOutputs + o];
+                    sumOfWeights += _members[m].weight;
+                }
+                output[o] /= sumOfWeights;
+                break;
+            }
+            case MEDIAN:
+            {
+                for (int m = 0; m < numOfMembers; m++)
+                {
+                    _scratch[m] = _memberOutputs[m * _numOfOutputs + o];
+                }
+                const auto middle = _scratch.begin() + numOfMembers / 2;
+                nth_element(_scratch.begin(), middle, _scratch.end());
+                output[o] = *middle;
+                if (numOfMembers % 2 == 0)
+                {
+                    output[o] = (output[o] + *max_element(_scratch.begin(), middle)) / 2;
+                }
+                break;
+            }
+        }
+    }
+    
+    return output;
+}
+
+vector<vector<double>> NetworkEnsemble::useMembers(const vector<double>& input)
+{
+    if (_members.empty())
+    {
+        return vector<vector<double>>();
+    }
+    
+    forwardPropagate(input);
+    
+    vector<vector<double>> outputs;
+    for (int m = 0; m < _members.size(); m++)
+    {
+        outputs.push_back(vector<double>(_memberOutputs.begin() + m * _numOfOutputs,
+                                         _memberOutputs.begin() + (m + 1) * _numOfOutputs));
+    }
+    return outputs;
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma  once
+
+#include "NeuralNetwork.h"
+
+#include <limits>
+#include <vector>
+
+namespace NeNet
+{
+
+enum EnsembleReduction
+{
+    MEAN = 0,
+    MEDIAN = 1,
+    WEIGHTED_MEAN = 2
+};
+
+/**
+ * Ensemble of trained networks evaluated in one pass.
+ *
+ * First layers of all members read the same input, so they are fused
+ * into one wide layer (each input value is loaded once for all members).
+ * Remaining layers of each member are stored as flat weight arrays.
+ * Members may differ in widths and depths of hidden layers,
+ * but must have the same number of inputs and outputs.
+ */
+class NetworkEnsemble
+{
+private:
+    struct Member
+    {
+        std::vector<int> numsOfPerceptrons;
+        std::vector<std::vector<double>> weights; // layers >= 1, in order of NeuralNetwork::getEdges()
+        std::vector<std::vector<double>> outputs; // layers >= 1
+        int firstLayerOffset; // position of member's first layer in the fused layer
+        double weight; // used for WEIGHTED_MEAN reduction
+        bool hasSoftmaxOutput;
+    };
+    
+    int _numOfInputs;
+    int _numOfOutputs;
+    
+    std::vector<Member> _members;
+    
+    /* Fused first layer, weights indexed by (from + 1) * width + column, from == -1 is bias */
+    int _firstLayerWidth;
+    std::vector<double> _firstLayerWeights;
+    std::vector<double> _firstLayerOutputs;
+    
+    std::vector<double> _memberOutputs; // indexed by member * numOfOutputs + output
+    std::vector<double> _scratch; // used for median
+    
+    /**
+     * Computes outputs of all members into _memberOutputs.
+     */
+    void forwardPropagate(const std::vector<double>& input);
+    
+public:
+    NetworkEnsemble();
+    
+    int getNumOfMembers() { return (int)_members.size(); }
+    
+    /**
+     * Adds snapshot of current weights of the network to the ensemble.
+     * Returns false if the number of inputs or outputs differs from other members.
+     */
+    bool addMember(NeuralNetwork& network, const double weight = 1);
+    
+    /**
+     * Returns outputs of all members reduced to one output vector.
+     * Returns empty vector if the ensemble has no members.
+     */
+    std::vector<double> use(const std::vector<double>& input, const EnsembleReduction reduction = MEAN);
+    
+    /**
+     * Returns NaN if the ensemble has no members.
+     */
+    double useForSingleOutput(const std::vector<double>& input, const EnsembleReduction reduction = MEAN) {
+        const std::vector<double> output = use(input, reduction);
+        return output.empty() ? std::numeric_limits<double>::quiet_NaN() : output[0];
+    }
+    
+    /**
+     * Returns outputs of individual members (same as their NeuralNetwork::use).
+     */
+    std::vector<std::vector<double>> useMembers(const std::vector<double>& input);
+};
+
+}
@@ -8,7 +8,10 @@
 //  Licensed under BSD
 
 #include "NeuralNetwork.h"
+#include "Activation.h"
 
+#include <algorithm>
+#include <limits>
 #include <random>
 #include <fstream>
 #include <sstream>
@@ -27,7 +30,16 @@ NeuralNetwork::NeuralNetwork(const int numOfInputs,
                              const std::vector<int> numsOfPerceptrons) :
     _numOfInputs(numOfInputs),
     _numOfLayers((int)numsOfPerceptrons.size()),
-    _numsOfPerceptrons(numsOfPerceptrons)
+    _numsOfPerceptrons(numsOfPerceptrons),
+    _weightsInitialized(false),
+    _numOfSeenPatterns(0),
+    _seed((unsigned int)time(nullptr)),
+    _lossFunction(SQUARED_ERROR),
+    _checkpointInterval(0),
+    _resumePending(false),
+    _resumeEpoch(0),
+    _resumeStepSize(0),
+    _minParallelLayerSize(0)
 
 {
     /* Creating the network skelet */
@@ -96,42 +108,314 @@ NeuralNetwork::NeuralNetwork(const int numOfInputs,
 double NeuralNetwork::forwardPropagateWithError(const vector<double>& input, double output)
 {
     forwardPropagate(input);
-    return pow(useForSingleOutput(input) - output, 2);
+    return getError(output);
+}
+
+double NeuralNetwork::forwardPropagateWithError(const SparseInput& input, double output)
+{
+    forwardPropagate(input);
+    return getError(output);
+}
+
+double NeuralNetwork::getError(const double output)
+{
+    const auto& outputLayer = _network[_numOfLayers - 1];
+    if (_lossFunction == SQUARED_ERROR)
+    {
+        return pow(outputLayer[0]->getOutput() - output, 2);
+    }
+    
+    vector<double> weightedSums(outputLayer.size());
+    for (int i = 0; i < outputLayer.size(); i++)
+    {
+        weightedSums[i] = outputLayer[i]->getWeightedSum();
+    }
+    return crossEntropyLoss(weightedSums.data(), (int)weightedSums.size(), output);
 }
     
 void NeuralNetwork::forwardPropagate(const vector<double>& input)
 {
     /* Place input values on input edges */
-    for (int i = 0; i < _numOfInputs; i++)
+    const int inputLayerSize = (int)_network[0].size();
+    propagateLayers([this, &input, inputLayerSize](int perceptron) {
+        for (int i = 0; i < _numOfInputs; i++)
+        {
+            _edges[(i + 1) * inputLayerSize + perceptron]->setValue(input[i]);
+        }
+        _network[0][perceptron]->processInputs();
+    });
+}
+
+bool NeuralNetwork::isNormalizedSparseInput(const SparseInput& input)
+{
+    for (int i = 0; i < input.size(); i++)
     {
-        for (int j = 0; j < _network[0].size() ; j++)
+        if (input[i].first < 0 || input[i].first >= _numOfInputs ||
+            (i > 0 && input[i].first <= input[i - 1].first))
         {
-            _edges[(i + 1) * _network[0].size() + j]->setValue(input[i]);
+            return false;
         }
     }
+    return true;
+}
+
+bool NeuralNetwork::normalizeSparseInput(const SparseInput& input, SparseInput& normalized)
+{
+    normalized = input;
+    stable_sort(normalized.begin(), normalized.end(),
+                [](const pair<int, double>& a, const pair<int, double>& b) { return a.first < b.first; });
     
-    /* Propagate through network */
-    for (const auto &layer : _network)
+    int size = 0;
+    for (const auto& feature : normalized)
     {
-        for (const auto &perceptron : layer)
+        if (feature.first < 0 || feature.first >= _numOfInputs)
+        {
+            return false;
+        }
+        if (size > 0 && normalized[size - 1].first == feature.first)
         {
-            perceptron->processInputs();
+            normalized[size - 1].second += feature.second;
+        }
+        else
+        {
+            normalized[size++] = feature;
         }
     }
+    normalized.resize(size);
+    return true;
+}
+
+void NeuralNetwork::forwardPropagate(const SparseInput& input)
+{
+    /* Values are placed only on input edges of non-zero features */
+    propagateLayers([this, &input](int perceptron) {
+        _network[0][perceptron]->processSparseInputs(input);
+    });
 }
 
-void NeuralNetwork::backwardPropagate(const double sampleOutput)
+void NeuralNetwork::propagateLayers(const function<void(int)>& processInputPerceptron)
 {
+    for (int l = 0; l < _numOfLayers; l++)
+    {
+        const auto& layer = _network[l];
+        if (_workerPool && layer.size() >= _minParallelLayerSize)
+        {
+            /* Perceptrons of one layer only read their own predecessors
+             * and write their own successors, so they can be processed in parallel */
+            _workerPool->run((int)layer.size(), [&layer, &processInputPerceptron, l](int begin, int end) {
+                for (int j = begin; j < end; j++)
+                {
+                    if (l == 0) {
+                        processInputPerceptron(j);
+                    } else {
+                        layer[j]->processInputs();
+                    }
+                }
+            });
+        }
+        else
+        {
+            for (int j = 0; j < layer.size(); j++)
+            {
+                if (l == 0) {
+                    processInputPerceptron(j);
+                } else {
+                    layer[j]->processInputs();
+                }
+            }
+        }
+    }
+    
+    /* Replacing sigmoid outputs by softmax */
+    if (hasSoftmaxOutput())
+    {
+        const auto& outputLayer = _network[_numOfLayers - 1];
+        vector<double> values(outputLayer.size());
+        for (int i = 0; i < outputLayer.size(); i++)
+        {
+            values[i] = outputLayer[i]->getWeightedSum();
+        }
+        softmax(values.data(), (int)values.size());
+        for (int i = 0; i < outputLayer.size(); i++)
+        {
+            outputLayer[i]->setOutput(values[i]);
+        }
+    }
+}
+
+void NeuralNetwork::backwardPropagate(const double sampleOutput, const SparseInput* sparseInput)
+{
+    /* With softmax output the sample output is index of the expected class */
+    const bool isClassIndex = hasSoftmaxOutput();
     for (int i = _numOfLayers - 1; i >= 0; i--)
     {
-        for (auto perceptron : _network[i])
+        for (int j = 0; j < _network[i].size(); j++)
+        {
+            if (isClassIndex && i == _numOfLayers - 1) {
+                _network[i][j]->calculateDelta(j == (int)sampleOutput ? 1 : 0);
+            } else if (sparseInput && i == 0) {
+                _network[i][j]->calculateSparseDelta(*sparseInput);
+            } else {
+                _network[i][j]->calculateDelta(sampleOutput);
+            }
+        }
+    }
+    
+}
+
+double NeuralNetwork::trainOnPattern(const vector<double>& input, const double output, const double stepSize)
+{
+    const double error = forwardPropagateWithError(input, output);
+    backwardPropagate(output);
+    
+    for (auto edge : _edges)
+    {
+        edge->setWeight(edge->getWeight() - edge->getError() * stepSize);
+    }
+    
+    _numOfSeenPatterns++;
+    return error;
+}
+
+double NeuralNetwork::trainOnPattern(const SparseInput& input, const double output, const double stepSize)
+{
+    const double error = forwardPropagateWithError(input, output);
+    backwardPropagate(output, &input);
+    
+    /* Input edges: bias and non-zero features only, ordered by origin, then by destination */
+    const int inputLayerSize = (int)_network[0].size();
+    auto updateInputEdges = [this, inputLayerSize, stepSize](int origin) {
+        for (int j = 0; j < inputLayerSize; j++)
         {
-            perceptron->calculateDelta(sampleOutput);
+            const auto& edge = _edges[origin * inputLayerSize + j];
+            edge->setWeight(edge->getWeight() - edge->getError() * stepSize);
         }
+    };
+    updateInputEdges(0);
+    for (const auto& feature : input)
+    {
+        updateInputEdges(feature.first + 1);
     }
     
+    for (int i = (_numOfInputs + 1) * inputLayerSize; i < _edges.size(); i++)
+    {
+        _edges[i]->setWeight(_edges[i]->getWeight() - _edges[i]->getError() * stepSize);
+    }
+    
+    _numOfSeenPatterns++;
+    return error;
+}
+
+void NeuralNetwork::setNumOfForwardThreads(const int numOfThreads, const int minParallelLayerSize)
+{
+    _workerPool.reset();
+    if (numOfThreads > 1)
+    {
+        _workerPool = make_shared<WorkerPool>(numOfThreads);
+    }
+    _minParallelLayerSize = max(1, minParallelLayerSize);
+}
+
+void NeuralNetwork::initializeWeights(const double lowerBound, const double upperBound)
+{
+    setWeights(generateWeights(_numOfInputs, _numsOfPerceptrons, _seed, lowerBound, upperBound));
+    _numOfSeenPatterns = 0;
 }
 
+int NeuralNetwork::getNumOfWeights(const int numOfInputs, const vector<int>& numsOfPerceptrons)
+{
+    int numOfWeights = 0;
+    int numOfOrigins = numOfInputs;
+    for (const auto numOfPerceptrons : numsOfPerceptrons)
+    {
+        numOfWeights += (numOfOrigins + 1) * numOfPerceptrons; // including bias
+        numOfOrigins = numOfPerceptrons;
+    }
+    return numOfWeights;
+}
+
+vector<double> NeuralNetwork::generateWeights(const int numOfInputs,
+                                              const vector<int>& numsOfPerceptrons,
+                                              const unsigned int seed,
+                                              const double lowerBound,
+                                              const double upperBound)
+{
+    mt19937 generator(seed);
+    uniform_real_distribution<double> distribution(lowerBound, upperBound);
+    vector<double> weights(getNumOfWeights(numOfInputs, numsOfPerceptrons));
+    for (auto& weight : weights)
+    {
+        weight = distribution(generator);
+    }
+    return weights;
+}
+
+bool NeuralNetwork::isValidSampleOutput(const double output)
+{
+    return !hasSoftmaxOutput() || (output >= 0 && output < _numsOfPerceptrons.back() && output == floor(output));
+}
+
+void NeuralNetwork::setLossFunction(const LossFunction lossFunction)
+{
+    _lossFunction = lossFunction;
+    for (auto perceptron : _network[_numOfLayers - 1])
+    {
+        perceptron->setLossFunction(lossFunction);
+    }
+}
+
+vector<double> NeuralNetwork::getWeights()
+{
+    vector<double> weights;
+    weights.reserve(_edges.size());
+    for (const auto& edge : _edges)
+    {
+        weights.push_back(edge->getWeight());
+    }
+    return weights;
+}
+
+void NeuralNetwork::setWeights(const vector<double>& weights)
+{
+    for (int i = 0; i < _edges.size(); i++)
+    {
+        _edges[i]->setWeight(weights[i]);
+    }
+    _weightsInitialized = true;
+}
+
+void NeuralNetwork::enableCheckpointing(const string& filePath, const int everyNumOfEpochs)
+{
+    _checkpointPath = filePath;
+    _checkpointInterval = max(1, everyNumOfEpochs);
+}
+
+bool NeuralNetwork::saveCheckpoint(const string& filePath, const int epoch, const double stepSize)
+{
+    return writeCheckpoint({_numOfInputs, _numsOfPerceptrons, _lossFunction, getWeights(),
+                            epoch, stepSize, _numOfSeenPatterns},
+                           filePath);
+}
+
+bool NeuralNetwork::resumeFromCheckpoint(const string& filePath)
+{
+    Checkpoint checkpoint;
+    if (!readCheckpoint(filePath, checkpoint) ||
+        checkpoint.numOfInputs != _numOfInputs ||
+        checkpoint.numsOfPerceptrons != _numsOfPerceptrons ||
+        checkpoint.lossFunction != _lossFunction ||
+        checkpoint.weights.size() != _edges.size())
+    {
+        return false;
+    }
+    
+    setWeights(checkpoint.weights);
+    _numOfSeenPatterns = checkpoint.numOfSeenPatterns;
+    _resumeEpoch = checkpoint.epoch;
+    _resumeStepSize = checkpoint.stepSize;
+    _resumePending = true;
+    return true;
+}
     
 void NeuralNetwork::train(const vector<pair<vector<double>, double>>& patterns,
                           const int numOfEpochs,
@@ -139,16 +423,88 @@ void NeuralNetwork::train(const vector<pair<vector<double>, double>>& patterns,
                           const double upperBound,
                           double stepSize,
                           const bool decreaseLearningRate,
-                          const double minStepSize)
+                          const double minStepSize,
+                          const bool warmStart)
+{
+    trainOnPatterns(patterns, numOfEpochs, lowerBound, upperBound, stepSize,
+                    decreaseLearningRate, minStepSize, warmStart);
+}
+
+void NeuralNetwork::train(const vector<pair<SparseInput, double>>& patterns,
+                          const int numOfEpochs,
+                          const double lowerBound,
+                          const double upperBound,
+                          double stepSize,
+                          const bool decreaseLearningRate,
+                          const double minStepSize,
+                          const bool warmStart)
+{
+    bool areNormalized = true;
+    for (const auto& pattern : patterns)
+    {
+        areNormalized = areNormalized && isNormalizedSparseInput(pattern.first);
+    }
+    if (areNormalized)
+    {
+        trainOnPatterns(patterns, numOfEpochs, lowerBound, upperBound, stepSize,
+                        decreaseLearningRate, minStepSize, warmStart);
+        return;
+    }
+    
+    /* Training on normalized copies of the patterns */
+    vector<pair<SparseInput, double>> normalizedPatterns(patterns.size());
+    for (int i = 0; i < patterns.size(); i++)
+    {
+        if (!normalizeSparseInput(patterns[i].first, normalizedPatterns[i].first))
+        {
+            cerr << "Feature index out of range in pattern " << i << endl;
+            return;
+        }
+        normalizedPatterns[i].second = patterns[i].second;
+    }
+    trainOnPatterns(normalizedPatterns, numOfEpochs, lowerBound, upperBound, stepSize,
+                    decreaseLearningRate, minStepSize, warmStart);
+}
+
+template<typename Input>
+void NeuralNetwork::trainOnPatterns(const vector<pair<Input, double>>& patterns,
+                                    const int numOfEpochs,
+                                    const double lowerBound,
+                                    const double upperBound,
+                                    double stepSize,
+                                    const bool decreaseLearningRate,
+                                    const double minStepSize,
+                                    const bool warmStart)
 {
+    for (int i = 0; i < patterns.size(); i++)
+    {
+        if (!isValidSampleOutput(patterns[i].second))
+        {
+            cerr << "Sample output of pattern " << i << " is not a class index" << endl;
+            return;
+        }
+    }
+    
     const double stepSizeDecrease = (stepSize - minStepSize) / numOfEpochs;
     
-    /* Initializing random weights to edges */
-    srand((unsigned int)time(nullptr));
-    for (auto edge : _edges)
+    /* Continuing interrupted training from restored checkpoint */
+    int firstEpoch = 0;
+    if (_resumePending)
+    {
+        firstEpoch = _resumeEpoch;
+        stepSize = _resumeStepSize;
+        _resumePending = false;
+    }
+    /* Initializing random weights to edges (kept as they are on warm start) */
+    else if (!warmStart || !_weightsInitialized)
     {
-        double random = ((double)rand() / RAND_MAX) * (upperBound - lowerBound) + lowerBound;
-        edge->setWeight(random);
+        initializeWeights(lowerBound, upperBound);
+    }
+    
+    unique_ptr<CheckpointWriter> checkpointWriter;
+    if (!_checkpointPath.empty())
+    {
+        checkpointWriter.reset(new CheckpointWriter(_checkpointPath));
     }
     
 #ifdef VERBOSE
@@ -162,17 +518,11 @@ void NeuralNetwork::train(const vector<pair<vector<double>, double>>& patterns,
     
     /* Running sequential training on the neural network */
     int index = 0;
-    for(int i = 0; i < numOfEpochs; i++) {
+    for(int i = firstEpoch; i < numOfEpochs; i++) {
         double error = 0;
         for (const auto& pattern : patterns)
         {
-            error += forwardPropagateWithError(pattern.first, pattern.second);
-            backwardPropagate(pattern.second);
-            
-            for (auto edge : _edges)
-            {
-                edge->setWeight(edge->getWeight() - edge->getError() * stepSize);
-            }
+            error += trainOnPattern(pattern.first, pattern.second, stepSize);
             
 #ifdef VERBOSE
             cout << "----------PATTERN " << index << "----------\n";
@@ -204,6 +554,94 @@ void NeuralNetwork::train(const vector<pair<vector<double>, double>>& patterns,
             stepSize -= stepSizeDecrease;
         }
         
+        if (checkpointWriter && ((i + 1) % _checkpointInterval == 0 || i + 1 == numOfEpochs))
+        {
+            checkpointWriter->submit({_numOfInputs, _numsOfPerceptrons, _lossFunction, getWeights(),
+                                      i + 1, stepSize, _numOfSeenPatterns});
+        }
+    }
+}
+
+double NeuralNetwork::partialFit(const vector<pair<vector<double>, double>>& patterns,
+                                 const double stepSize)
+{
+    if (patterns.empty())
+    {
+        return 0;
+    }
+    for (const auto& pattern : patterns)
+    {
+        if (!isValidSampleOutput(pattern.second))
+        {
+            return numeric_limits<double>::quiet_NaN();
+        }
+    }
+    
+    double error = 0;
+    for (const auto& pattern : patterns)
+    {
+        error += partialFit(pattern.first, pattern.second, stepSize);
+    }
+    return error / patterns.size();
+}
+
+double NeuralNetwork::partialFit(const vector<double>& input, const double output, const double stepSize)
+{
+    if (!isValidSampleOutput(output))
+    {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    
+    if (!_weightsInitialized)
+    {
+        initializeWeights(0, 1);
+    }
+    return trainOnPattern(input, output, stepSize);
+}
+
+double NeuralNetwork::partialFit(const SparseInput& input, const double output, const double stepSize)
+{
+    if (!isValidSampleOutput(output))
+    {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    
+    if (!isNormalizedSparseInput(input))
+    {
+        SparseInput normalized;
+        return normalizeSparseInput(input, normalized) ? partialFit(normalized, output, stepSize)
+                                                       : numeric_limits<double>::quiet_NaN();
+    }
+    
+    if (!_weightsInitialized)
+    {
+        initializeWeights(0, 1);
+    }
+    return trainOnPattern(input, output, stepSize);
+}
+
+double NeuralNetwork::addGradient(const vector<double>& input, const double output, vector<double>& gradients)
+{
+    if (!isValidSampleOutput(output))
+    {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    
+    const double error = forwardPropagateWithError(input, output);
+    backwardPropagate(output);
+    
+    for (int i = 0; i < _edges.size(); i++)
+    {
+        gradients[i] += _edges[i]->getError();
+    }
+    return error;
+}
+
+void NeuralNetwork::applyGradient(const vector<double>& gradients, const double stepSize)
+{
+    for (int i = 0; i < _edges.size(); i++)
+    {
+        _edges[i]->setWeight(_edges[i]->getWeight() - gradients[i] * stepSize);
     }
 }
 
@@ -220,6 +658,75 @@ vector<double> NeuralNetwork::use(const vector<double>& input)
     return output;
 }
 
+vector<double> NeuralNetwork::use(const SparseInput& input)
+{
+    if (!isNormalizedSparseInput(input))
+    {
+        SparseInput normalized;
+        return normalizeSparseInput(input, normalized) ? use(normalized) : vector<double>();
+    }
+    
+    forwardPropagate(input);
+    
+    vector<double> output;
+    for(auto outputPerceptron : _network[_numOfLayers - 1])
+    {
+        output.push_back(outputPerceptron->getOutput());
+    }
+    
+    return output;
+}
+
+vector<vector<double>> NeuralNetwork::useBatch(const vector<vector<double>>& inputs)
+{
+    const vector<double> weights = getWeights();
+    
+    /* Values of the current layer for the whole batch, indexed by pattern * layer width + perceptron,
+       inputs of wrong size are left out */
+    vector<double> values;
+    values.reserve(inputs.size() * _numOfInputs);
+    for (const auto& input : inputs)
+    {
+        if (input.size() == _numOfInputs)
+        {
+            values.insert(values.end(), input.begin(), input.end());
+        }
+    }
+    const int batchSize = (int)values.size() / _numOfInputs;
+    
+    /* Weights of each layer are ordered by origin (bias first), then by destination */
+    int offset = 0;
+    int numOfLayerInputs = _numOfInputs;
+    for (int layer = 0; layer < _numOfLayers; layer++)
+    {
+        const int layerSize = _numsOfPerceptrons[layer];
+        const double* layerWeights = weights.data() + offset;
+        
+        const bool isSoftmax = layer == _numOfLayers - 1 && hasSoftmaxOutput();
+        vector<double> outputs(batchSize * layerSize);
+        for (int p = 0; p < batchSize; p++)
+        {
+            computeLayerOutputs(layerWeights, values.data() + p * numOfLayerInputs, numOfLayerInputs, layerSize,
+                                isSoftmax, outputs.data() + p * layerSize);
+        }
+        
+        values = move(outputs);
+        offset += (numOfLayerInputs + 1) * layerSize;
+        numOfLayerInputs = layerSize;
+    }
+    
+    vector<vector<double>> outputs(inputs.size());
+    for (int i = 0, p = 0; i < inputs.size(); i++)
+    {
+        if (inputs[i].size() == _numOfInputs)
+        {
+            outputs[i].assign(values.begin() + p * numOfLayerInputs, values.begin() + (p + 1) * numOfLayerInputs);
+            p++;
+        }
+    }
+    return outputs;
+}
+
 function<double(double, double)> NeuralNetwork::get3DFunction()
 {
     return [this](double x, double y) -> double {
@@ -2,6 +2,8 @@
 
 #include "Perceptron.h"
 #include "Edge.h"
+#include "Checkpoint.h"
+#include "WorkerPool.h"
 
 #include <iostream>
 #include <vector>
@@ -19,27 +21,200 @@ private:
     std::vector<std::shared_ptr<Edge>> _edges;
     std::vector<std::shared_ptr<Edge>> _outputEdges;
     
+    bool _weightsInitialized; // false until first initialization of weights
+    long _numOfSeenPatterns; // number of patterns used for training so far (across all calls)
+    unsigned int _seed; // seed for random initialization of weights
+    LossFunction _lossFunction;
+    
+    /* Checkpointing of training */
+    std::string _checkpointPath; // empty if checkpointing is disabled
+    int _checkpointInterval; // in epochs
+    bool _resumePending; // next call of train continues from restored checkpoint
+    int _resumeEpoch;
+    double _resumeStepSize;
+    
+    /* Intra-layer parallelism of forward propagation */
+    std::shared_ptr<WorkerPool> _workerPool; // null if forward propagation is serial
+    int _minParallelLayerSize; // narrower layers are propagated serially
+    
     /**
      * Triggers forward propagation in network with given input
      */
     void forwardPropagate(const std::vector<double>& input);
+    void forwardPropagate(const SparseInput& input);
+    
+    /**
+     * Propagates through all layers, processInputPerceptron is called
+     * for each perceptron (index) of the first layer.
+     */
+    void propagateLayers(const std::function<void(int)>& processInputPerceptron);
+    
+    /**
+     * Returns loss of the network (after forward propagation) on the pattern.
+     */
+    double getError(const double output);
+    
+    /**
+     * Returns true if indices of the sparse input are in range, sorted and unique,
+     * i.e. the input can be propagated as it is.
+     */
+    bool isNormalizedSparseInput(const SparseInput& input);
     
+    /**
+     * Sorts the sparse input by index and sums values of repeated indices.
+     * Returns false if any index is out of range.
+     */
+    bool normalizeSparseInput(const SparseInput& input, SparseInput& normalized);
+    
+    /**
+     * Triggers forward propagation and returns loss of the network on the pattern.
+     */
     double forwardPropagateWithError(const std::vector<double>& input, double output);
+    double forwardPropagateWithError(const SparseInput& input, double output);
+    
+    /**
+     * Triggers backward propagation in network for given sample (pattern) output.
+     * If sparseInput is given, only edges of its features are touched in the first layer.
+     */
+    void backwardPropagate(const double sampleOutput, const SparseInput* sparseInput = nullptr);
+    
+    /**
+     * Performs one step of sequential (online) training on a single pattern.
+     * Returns loss of the network on the pattern before the update.
+     */
+    double trainOnPattern(const std::vector<double>& input, const double output, const double stepSize);
+    
+    /**
+     * Sparse variant of trainOnPattern, only weights of input edges
+     * of non-zero features are updated in the first layer.
+     */
+    double trainOnPattern(const SparseInput& input, const double output, const double stepSize);
     
     /**
-     * Triggers backward propagation in network for given sample (pattern) output
+     * Common implementation of train for dense and sparse patterns.
      */
-    void backwardPropagate(const double sampleOutput);
+    template<typename Input>
+    void trainOnPatterns(const std::vector<std::pair<Input, double>>& patterns,
+                         const int numOfEpochs,
+                         const double lowerBound,
+                         const double upperBound,
+                         double stepSize,
+                         const bool decreaseLearningRate,
+                         const double minStepSize,
+                         const bool warmStart);
     
 public:
     
+    static const int DEFAULT_MIN_PARALLEL_LAYER_SIZE = 256;
+    
     NeuralNetwork(const int numOfInputs,
                   const std::vector<int> numsOfPerceptrons);
     
     std::vector<std::shared_ptr<Edge>> getEdges() { return _edges; }
     
+    long getNumOfSeenPatterns() { return _numOfSeenPatterns; }
+    
+    bool areWeightsInitialized() { return _weightsInitialized; }
+    
+    int getNumOfInputs() { return _numOfInputs; }
+    std::vector<int> getNumsOfPerceptrons() { return _numsOfPerceptrons; }
+    
+    /**
+     * Sets seed used by the next initialization of weights
+     * (current time is used by default).
+     */
+    void setSeed(const unsigned int seed) { _seed = seed; }
+    
+    /**
+     * Sets loss minimized by training (SQUARED_ERROR by default).
+     *
+     * CROSS_ENTROPY with one output perceptron is binary cross-entropy of sigmoid output,
+     * sample output is expected to be 0 or 1.
+     * CROSS_ENTROPY with more output perceptrons turns output layer to softmax,
+     * sample output is then index of the expected class.
+     * In both cases the delta of output perceptrons is simply (output - target)
+     * and reported error is computed from weighted sums in numerically stable form.
+     */
+    void setLossFunction(const LossFunction lossFunction);
+    
+    LossFunction getLossFunction() { return _lossFunction; }
+    
+    bool hasSoftmaxOutput() {
+        return _lossFunction == CROSS_ENTROPY && _numsOfPerceptrons.back() > 1;
+    }
+    
+    /**
+     * Returns false if the sample output cannot be trained on, i.e. the output layer
+     * is softmax and the sample output is not a class index in [0, number of outputs).
+     */
+    bool isValidSampleOutput(const double output);
+    
+    /**
+     * Returns weights of all edges (in order of getEdges()).
+     */
+    std::vector<double> getWeights();
+    
+    /**
+     * Sets weights of all edges (in order of getEdges()).
+     */
+    void setWeights(const std::vector<double>& weights);
+    
+    /**
+     * Makes train write checkpoint to filePath every everyNumOfEpochs epochs.
+     * Checkpoints are written on a background thread while training continues.
+     */
+    void enableCheckpointing(const std::string& filePath, const int everyNumOfEpochs);
+    
+    void disableCheckpointing() { _checkpointPath.clear(); }
+    
+    /**
+     * Synchronously writes current weights and given training state to filePath.
+     */
+    bool saveCheckpoint(const std::string& filePath, const int epoch = 0, const double stepSize = 0);
+    
+    /**
+     * Restores weights and training state from checkpoint.
+     * The next call of train (with the same arguments as the interrupted one)
+     * continues from the restored epoch and step size instead of starting over.
+     * Returns false if the checkpoint cannot be read or topology or loss function does not match.
+     */
+    bool resumeFromCheckpoint(const std::string& filePath);
+    
+    /**
+     * Splits perceptrons of each layer at least minParallelLayerSize wide among
+     * numOfThreads threads (including the caller) in forward propagation, which lowers
+     * latency of a single use() on wide networks. Narrower layers stay serial,
+     * as synchronization would cost more than it saves. numOfThreads <= 1 disables it.
+     * The network must not be used from more threads at once anyway.
+     */
+    void setNumOfForwardThreads(const int numOfThreads,
+                                const int minParallelLayerSize = DEFAULT_MIN_PARALLEL_LAYER_SIZE);
+    
+    /**
+     * Sets all weights to random values from [lowerBound, upperBound].
+     */
+    void initializeWeights(const double lowerBound, const double upperBound);
+    
+    /**
+     * Returns number of weights (edges) of network of given topology.
+     */
+    static int getNumOfWeights(const int numOfInputs, const std::vector<int>& numsOfPerceptrons);
+    
+    /**
+     * Returns the same weights (in order of getEdges()) as initializeWeights would set
+     * with given seed, without building the network (so it is safe to call from any thread).
+     */
+    static std::vector<double> generateWeights(const int numOfInputs,
+                                               const std::vector<int>& numsOfPerceptrons,
+                                               const unsigned int seed,
+                                               const double lowerBound,
+                                               const double upperBound);
+    
     /**
      * Triggers training of the network given vector of training patterns.
+     * Weights are re-randomised before training unless warmStart is set
+     * and the network has already been trained.
+     * Nothing is trained if any sample output is not valid (see isValidSampleOutput).
      */
     void train(const std::vector<std::pair<std::vector<double>, double>>& patterns,
                const int numOfEpochs,
@@ -47,7 +222,57 @@ public:
                const double upperBound,
                double stepSize,
                const bool decreaseLearningRate = false,
-               const double minStepSize = 0.01);
+               const double minStepSize = 0.01,
+               const bool warmStart = false);
+    
+    /**
+     * Training on sparse patterns, e.g. high-dimensional one-hot or hashed features.
+     * Cost of a pattern in the first layer is proportional to the number of its
+     * non-zero features instead of the number of inputs. Results are the same
+     * as of training on equivalent dense patterns (see SparseInput).
+     * Nothing is trained if any pattern has feature index out of range
+     * or invalid sample output.
+     */
+    void train(const std::vector<std::pair<SparseInput, double>>& patterns,
+               const int numOfEpochs,
+               const double lowerBound,
+               const double upperBound,
+               double stepSize,
+               const bool decreaseLearningRate = false,
+               const double minStepSize = 0.01,
+               const bool warmStart = false);
+    
+    /**
+     * Incremental training: runs one pass over given patterns without
+     * re-randomising weights, so it can be called repeatedly on new data
+     * as it arrives. Memory used does not depend on number of patterns seen.
+     * Weights are initialized from [0, 1] on the very first call.
+     * Returns mean loss over the patterns before their updates.
+     * Nothing is trained and NaN is returned if any sample output is not valid.
+     */
+    double partialFit(const std::vector<std::pair<std::vector<double>, double>>& patterns,
+                      const double stepSize);
+    
+    /**
+     * Incremental training on a single streamed pattern.
+     * Pattern with invalid sample output (see isValidSampleOutput) or sparse pattern
+     * with feature index out of range is ignored and NaN is returned.
+     */
+    double partialFit(const std::vector<double>& input, const double output, const double stepSize);
+    double partialFit(const SparseInput& input, const double output, const double stepSize);
+    
+    /**
+     * Adds gradient of the loss on the pattern (i.e. error of each edge, in order of getEdges())
+     * to gradients, without changing weights. Returns loss on the pattern.
+     * Pattern with invalid sample output is ignored and NaN is returned.
+     * Used for mini-batch and distributed training.
+     */
+    double addGradient(const std::vector<double>& input, const double output, std::vector<double>& gradients);
+    
+    /**
+     * Updates each weight by (- gradient * stepSize).
+     */
+    void applyGradient(const std::vector<double>& gradients, const double stepSize);
     
     /**
      * Use the network for producing output.
@@ -55,6 +280,21 @@ public:
      */
     std::vector<double> use(const std::vector<double>& input);
     
+    /**
+     * Use the network on sparse input, only weights of its non-zero features
+     * are touched in the first layer.
+     * Returns empty vector if any feature index is out of range.
+     */
+    std::vector<double> use(const SparseInput& input);
+    
+    /**
+     * Use the network for producing outputs of many inputs at once.
+     * Gives the same outputs as calling use on each input, but works on flat copy of weights
+     * layer by layer for the whole batch, which is much faster for larger batches.
+     * Output of input which does not have getNumOfInputs() values is empty.
+     */
+    std::vector<std::vector<double>> useBatch(const std::vector<std::vector<double>>& inputs);
+    
     /**
      * Return output as double if only 1 output is expected 
      * (instead of vector of doubles).
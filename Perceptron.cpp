@@ -1,5 +1,6 @@
 #include "Perceptron.h"
 #include "Edge.h"
+#include "Activation.h"
 
 using namespace std;
 
@@ -22,7 +23,7 @@ Perceptron::Perceptron(Type type, u_int layer, u_int index) :
     if (_type == INPUT || _type == HIDDEN || _type == OUTPUT)
     {
         _activationFun = [](double x) {
-            return 1.0 / (1.0 + exp(-1.0 * x));
+            return sigmoid(x);
         };
         
         auto actFun = _activationFun;
@@ -43,7 +44,7 @@ Perceptron::Perceptron(Type type, u_int layer, u_int index) :
     
     /* Initializing error functions 
      *
-     * Square distance error function used
+     * Square distance error function used (cross-entropy bypasses them, see calculateDelta)
      */
     
     _errorFun = [](double networkOutput, double sampleOut) {
@@ -54,6 +55,22 @@ Perceptron::Perceptron(Type type, u_int layer, u_int index) :
         return 2 * (networkOutput - sampleOut);
     };
     
+    _lossFunction = SQUARED_ERROR;
+}
+
+void Perceptron::setLossFunction(LossFunction lossFunction)
+{
+    _lossFunction = lossFunction;
+}
+
+void Perceptron::setOutput(double output)
+{
+    _output = output;
+    
+    for (const auto &successor : _successors)
+    {
+        successor.lock()->setValue(_output);
+    }
 }
 
 void Perceptron::processInputs()
@@ -72,11 +89,37 @@ void Perceptron::processInputs()
     }
 }
 
+void Perceptron::processSparseInputs(const SparseInput& input)
+{
+    _weightedSum = 0;
+    _weightedSum += _predecessors[0].lock()->getWeightedValue();
+    for (const auto &feature : input)
+    {
+        const auto edge = _predecessors[feature.first + 1].lock();
+        edge->setValue(feature.second);
+        _weightedSum += edge->getWeightedValue();
+    }
+    
+    _output = _activationFun(_weightedSum);
+    
+    for (const auto &successor : _successors)
+    {
+        successor.lock()->setValue(_output);
+    }
+}
+
 void Perceptron::calculateDelta(double sampleOutput)
 {
     if (_type == OUTPUT)
     {
-        _delta = _errorFunDer(_output, sampleOutput) * _activationFunDer(_weightedSum);
+        if (_lossFunction == CROSS_ENTROPY)
+        {
+            _delta = _output - sampleOutput;
+        }
+        else
+        {
+            _delta = _errorFunDer(_output, sampleOutput) * _activationFunDer(_weightedSum);
+        }
         for (const auto edge : _predecessors)
         {
             edge.lock()->setError(edge.lock()->getValue() * _delta);
@@ -99,4 +142,22 @@ void Perceptron::calculateDelta(double sampleOutput)
     }
 }
 
+void Perceptron::calculateSparseDelta(const SparseInput& input)
+{
+    _delta = 0;
+    for (const auto &edge : _successors)
+    {
+        _delta += edge.lock()->getSuccessorDelta() * edge.lock()->getWeight();
+    }
+    
+    const double derivative = _activationFunDer(_weightedSum);
+    const auto bias = _predecessors[0].lock();
+    bias->setError(bias->getValue() * derivative * _delta);
+    for (const auto &feature : input)
+    {
+        const auto edge = _predecessors[feature.first + 1].lock();
+        edge->setError(edge->getValue() * derivative * _delta);
+    }
+}
+
 }
\ No newline at end of file
@@ -14,6 +14,20 @@ enum Type
     OUTPUT = 2
 };
 
+enum LossFunction
+{
+    SQUARED_ERROR = 0,
+    CROSS_ENTROPY = 1 // fused with sigmoid (or softmax) output, see NeuralNetwork::setLossFunction
+};
+
+/**
+ * Sparse input: (feature index, value) pairs of non-zero features.
+ * Indices must be in [0, numOfInputs), input with other index is rejected by NeuralNetwork.
+ * Pairs need not be sorted and an index may repeat (e.g. hashed features colliding),
+ * values of repeated index are summed, just as they would be in equivalent dense input.
+ */
+typedef std::vector<std::pair<int, double>> SparseInput;
+
 class Edge;
 
 class Perceptron
@@ -24,6 +38,7 @@ private:
     const u_int _index;
     
     Type _type;
+    LossFunction _lossFunction;
 
     std::vector<std::weak_ptr<Edge>> _predecessors;
     std::vector<std::weak_ptr<Edge>> _successors;
@@ -44,6 +59,20 @@ public:
     double getDelta() { return _delta; }
     double getOutput() { return _output; }
     double getType() { return _type; }
+    double getWeightedSum() { return _weightedSum; }
+    
+    /**
+     * Overrides output computed by processInputs (used for softmax output layer)
+     * and places it on the output edges.
+     */
+    void setOutput(double output);
+    
+    /**
+     * Sets error functions of the perceptron.
+     * For CROSS_ENTROPY the delta of output perceptron is simplified to
+     * (output - sample output), as derivative of sigmoid/softmax cancels out.
+     */
+    void setLossFunction(LossFunction lossFunction);
     
     void addPredecessor(std::shared_ptr<Edge> predecessor) {
         _predecessors.push_back(predecessor);
@@ -60,6 +89,13 @@ public:
      */
     void processInputs();
     
+    /**
+     * Sparse variant of processInputs for perceptrons of the first layer.
+     * Only bias and input edges of given non-zero features are read
+     * (input edges are expected in order of features, after the bias edge).
+     */
+    void processSparseInputs(const SparseInput& input);
+    
     /**
      * Used in backward propagation.
      * Method calculates the delta of the multilayer perceptron 
@@ -67,6 +103,13 @@ public:
      */
     void calculateDelta(double sampleOutput);
     
+    /**
+     * Sparse variant of calculateDelta for perceptrons of the first layer.
+     * Errors are set only on bias and input edges of given non-zero features
+     * (errors of the other input edges would be zero).
+     */
+    void calculateSparseDelta(const SparseInput& input);
+    
     
 };
     
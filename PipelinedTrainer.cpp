@@ -0,0 +1,512 @@
+#include "PipelinedTrainer.h"
+#include "Activation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace NeNet
+{
+
+PipelinedTrainer::PipelinedTrainer(const int numOfStages,
+                                   const int miniBatchSize,
+                                   const int microBatchSize) :
+    _numOfStages(max(1, numOfStages)),
+    _miniBatchSize(max(1, miniBatchSize)),
+    _microBatchSize(max(1, microBatchSize)),
+    _printProgress(true),
+    _numOfInputs(0),
+    _lossFunction(SQUARED_ERROR),
+    _hasSoftmaxOutput(false),
+    _patterns(nullptr),
+    _stashAllLayers(true),
+    _activationMemoryBudget(0)
+{
+}
+
+void PipelinedTrainer::setStashedLayers(const vector<int>& layers)
+{
+    _stashedLayers = layers;
+    _stashAllLayers = false;
+    _activationMemoryBudget = 0;
+}
+
+void PipelinedTrainer::setActivationMemoryBudget(const size_t bytes)
+{
+    _activationMemoryBudget = bytes;
+}
+
+void PipelinedTrainer::chooseStashedLayers()
+{
+    const int numOfLayers = (int)_numsOfPerceptrons.size();
+    _isLayerStashed.assign(numOfLayers, _stashAllLayers);
+    for (const auto layer : _stashedLayers)
+    {
+        if (0 <= layer && layer < numOfLayers)
+        {
+            _isLayerStashed[layer] = true;
+        }
+    }
+    if (_activationMemoryBudget == 0)
+    {
+        return;
+    }
+    
+    /* Outputs of last layers of stages are inputs of the next stages, those are always kept */
+    vector<bool> isStageInput(numOfLayers, false);
+    for (int s = 0; s + 1 < _stages.size(); s++)
+    {
+        isStageInput[_stages[s]->lastLayer] = true;
+    }
+    
+    /* Stashing every spacing-th layer, the smallest spacing which fits into the budget wins.
+     * Memory is estimated for the maximal number of micro-batches in flight
+     * plus one segment of layers recomputed in backward pass */
+    const size_t numOfInFlight = _stages.size();
+    for (int spacing = 1; spacing <= numOfLayers; spacing++)
+    {
+        size_t stashedPerPattern = _numOfInputs;
+        size_t segmentPerPattern = 0;
+        size_t maxSegmentPerPattern = 0;
+        for (int layer = 0; layer < numOfLayers; layer++)
+        {
+            if ((layer + 1) % spacing == 0 || isStageInput[layer])
+            {
+                stashedPerPattern += _numsOfPerceptrons[layer];
+                segmentPerPattern = 0;
+            }
+            else
+            {
+                segmentPerPattern += _numsOfPerceptrons[layer];
+                maxSegmentPerPattern = max(maxSegmentPerPattern, segmentPerPattern);
+            }
+        }
+        
+        const size_t bytes = (numOfInFlight * stashedPerPattern + maxSegmentPerPattern) * _microBatchSize * sizeof(double);
+        if (bytes <= _activationMemoryBudget || spacing == numOfLayers)
+        {
+            for (int layer = 0; layer < numOfLayers; layer++)
+            {
+                _isLayerStashed[layer] = (layer + 1) % spacing == 0;
+            }
+            return;
+        }
+    }
+}
+
+void PipelinedTrainer::createStages(const vector<double>& weights)
+{
+    const int numOfLayers = (int)_numsOfPerceptrons.size();
+    const int numOfStages = min(_numOfStages, numOfLayers);
+    
+    /* In flight are at most numOfStages micro-batches, plus one UPDATE and STOP */
+    const size_t capacity = numOfStages + 2;
+    
+    vector<int> numsOfLayerWeights;
+    for (int layer = 0; layer < numOfLayers; layer++)
+    {
+        numsOfLayerWeights.push_back((getNumOfLayerInputs(layer) + 1) * _numsOfPerceptrons[layer]);
+    }
+    const double numOfWeights = weights.size();
+    
+    _stages.clear();
+    int layer = 0;
+    int offset = 0;
+    double accumulated = 0;
+    for (int s = 0; s < numOfStages; s++)
+    {
+        unique_ptr<Stage> stage(new Stage(capacity));
+        stage->firstLayer = layer;
+        
+        /* Taking layers until the stage has its share of weights, leaving at least one layer for each next stage */
+        do {
+            accumulated += numsOfLayerWeights[layer];
+            stage->weights.push_back(vector<double>(weights.begin() + offset,
+                                                    weights.begin() + offset + numsOfLayerWeights[layer]));
+            stage->gradients.push_back(vector<double>(numsOfLayerWeights[layer], 0));
+            offset += numsOfLayerWeights[layer];
+            layer++;
+        } while (layer < numOfLayers - (numOfStages - s - 1) &&
+                 (s == numOfStages - 1 || accumulated < numOfWeights * (s + 1) / numOfStages));
+        
+        stage->lastLayer = layer - 1;
+        _stages.push_back(move(stage));
+    }
+    
+    _completionQueue.reset(new SpscQueue<Message>(capacity));
+}
+
+void PipelinedTrainer::runStage(const int s)
+{
+    Stage& stage = *_stages[s];
+    const bool isLastStage = s == _stages.size() - 1;
+    
+    Message message;
+    while (true)
+    {
+        /* Backward work first, so finished micro-batches free their stash early */
+        if (stage.backwardQueue.tryPop(message))
+        {
+            backward(s, message);
+        }
+        else if (stage.forwardQueue.tryPop(message))
+        {
+            switch (message.type)
+            {
+                case FORWARD:
+                    forward(s, message);
+                    break;
+                case UPDATE:
+                    update(s, message);
+                    if (!isLastStage)
+                    {
+                        _stages[s + 1]->forwardQueue.push(move(message));
+                    }
+                    break;
+                case STOP:
+                    if (!isLastStage)
+                    {
+                        _stages[s + 1]->forwardQueue.push(move(message));
+                    }
+                    return;
+                default:
+                    break;
+            }
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+}
+
+void PipelinedTrainer::computeLayer(const Stage& stage, const int layer, const int n,
+                                    const vector<double>& inputs, vector<double>& outputs,
+                                    vector<double>& weightedSums)
+{
+    const int numOfLayers = (int)_numsOfPerceptrons.size();
+    const int numOfLayerInputs = getNumOfLayerInputs(layer);
+    const int layerSize = _numsOfPerceptrons[layer];
+    const bool isOutputLayer = layer == numOfLayers - 1;
+    const vector<double>& weights = stage.weights[layer - stage.firstLayer];
+    outputs.resize(n * layerSize);
+    
+    if (!isOutputLayer)
+    {
+        for (int p = 0; p < n; p++)
+        {
+            computeLayerOutputs(weights.data(), inputs.data() + p * numOfLayerInputs, numOfLayerInputs, layerSize,
+                                false, outputs.data() + p * layerSize);
+        }
+        return;
+    }
+    
+    /* Weighted sums of output layer are kept for the loss */
+    weightedSums.resize(n * layerSize);
+    for (int p = 0; p < n; p++)
+    {
+        double* sums = weightedSums.data() + p * layerSize;
+        computeWeightedSums(weights.data(), inputs.data() + p * numOfLayerInputs, numOfLayerInputs, layerSize, sums);
+        copy(sums, sums + layerSize, outputs.begin() + p * layerSize);
+        activate(outputs.data() + p * layerSize, layerSize, _hasSoftmaxOutput);
+    }
+}
+
+void PipelinedTrainer::restoreValues(const Stage& stage, const int n,
+                                     vector<vector<double>>& values, const int k)
+{
+    /* Recomputing forward from the nearest kept values (input of the stage is always kept) */
+    int kept = k;
+    while (values[kept].empty())
+    {
+        kept--;
+    }
+    
+    vector<double> weightedSums;
+    for (int i = kept; i < k; i++)
+    {
+        computeLayer(stage, stage.firstLayer + i, n, values[i], values[i + 1], weightedSums);
+    }
+}
+
+void PipelinedTrainer::forward(const int s, Message& message)
+{
+    Stage& stage = *_stages[s];
+    const int n = message.numOfPatterns;
+    
+    /* values[0] is input of the stage, values[k + 1] outputs of its k-th layer */
+    vector<vector<double>> values(stage.lastLayer - stage.firstLayer + 2);
+    if (s == 0)
+    {
+        for (int p = 0; p < n; p++)
+        {
+            const auto& input = (*_patterns)[message.firstPattern + p].first;
+            values[0].insert(values[0].end(), input.begin(), input.begin() + _numOfInputs);
+        }
+    }
+    else
+    {
+        values[0] = move(message.values);
+    }
+    
+    vector<double> weightedSums; // of the output layer, for loss
+    for (int layer = stage.firstLayer; layer <= stage.lastLayer; layer++)
+    {
+        const int k = layer - stage.firstLayer;
+        computeLayer(stage, layer, n, values[k], values[k + 1], weightedSums);
+        
+        /* Input of this layer is not needed anymore unless it is stashed */
+        if (k > 0 && !_isLayerStashed[layer - 1])
+        {
+            vector<double>().swap(values[k]);
+        }
+    }
+    
+    if (s < _stages.size() - 1)
+    {
+        if (_isLayerStashed[stage.lastLayer]) {
+            message.values = values.back();
+        } else {
+            message.values = move(values.back());
+            values.back().clear();
+        }
+        stage.stash[message.microBatch] = move(values);
+        _stages[s + 1]->forwardQueue.push(move(message));
+        return;
+    }
+    
+    /* Last stage: loss and deltas of output layer (as in NeuralNetwork::forwardPropagateWithError
+     * and Perceptron::calculateDelta), then backward propagation right away */
+    const int outputSize = _numsOfPerceptrons.back();
+    const vector<double>& outputs = values.back();
+    vector<double> deltas(n * outputSize);
+    double error = 0;
+    for (int p = 0; p < n; p++)
+    {
+        const double sampleOutput = (*_patterns)[message.firstPattern + p].second;
+        const double* out = outputs.data() + p * outputSize;
+        const double* sums = weightedSums.data() + p * outputSize;
+        
+        if (_lossFunction == SQUARED_ERROR)
+        {
+            error += pow(out[0] - sampleOutput, 2);
+        }
+        else
+        {
+            error += crossEntropyLoss(sums, outputSize, sampleOutput);
+        }
+        
+        for (int j = 0; j < outputSize; j++)
+        {
+            const double o = out[j];
+            if (_lossFunction == SQUARED_ERROR) {
+                deltas[p * outputSize + j] = 2 * (o - sampleOutput) * (o * (1.0 - o));
+            } else if (_hasSoftmaxOutput) {
+                deltas[p * outputSize + j] = o - (j == (int)sampleOutput ? 1 : 0);
+            } else {
+                deltas[p * outputSize + j] = o - sampleOutput;
+            }
+        }
+    }
+    
+    if (!_isLayerStashed[stage.lastLayer])
+    {
+        vector<double>().swap(values.back());
+    }
+    stage.stash[message.microBatch] = move(values);
+    message.type = BACKWARD;
+    message.error = error;
+    message.values = move(deltas);
+    backward(s, message);
+}
+
+void PipelinedTrainer::backward(const int s, Message& message)
+{
+    Stage& stage = *_stages[s];
+    const int numOfLayers = (int)_numsOfPerceptrons.size();
+    const int n = message.numOfPatterns;
+    
+    const auto stashed = stage.stash.find(message.microBatch);
+    vector<vector<double>> values = move(stashed->second);
+    stage.stash.erase(stashed);
+    
+    vector<double> deltas = move(message.values);
+    for (int layer = stage.lastLayer; layer >= stage.firstLayer; layer--)
+    {
+        const int k = layer - stage.firstLayer;
+        const int numOfLayerInputs = getNumOfLayerInputs(layer);
+        const int layerSize = _numsOfPerceptrons[layer];
+        const bool isOutputLayer = layer == numOfLayers - 1;
+        const vector<double>& weights = stage.weights[k];
+        
+        /* Layers which were not stashed are recomputed (outputs of the output layer are not needed) */
+        if (!isOutputLayer)
+        {
+            restoreValues(stage, n, values, k + 1);
+        }
+        restoreValues(stage, n, values, k);
+        
+        const vector<double>& inputs = values[k];
+        const vector<double>& outputs = values[k + 1];
+        vector<double>& gradients = stage.gradients[k];
+        
+        /* Error of edge is value * delta for output layer
+         * and value * derivative of activation * delta for others */
+        for (int p = 0; p < n; p++)
+        {
+            for (int from = -1; from < numOfLayerInputs; from++)
+            {
+                const double value = from == -1 ? 1 : inputs[p * numOfLayerInputs + from];
+                for (int to = 0; to < layerSize; to++)
+                {
+                    const double delta = deltas[p * layerSize + to];
+                    if (isOutputLayer) {
+                        gradients[(from + 1) * layerSize + to] += value * delta;
+                    } else {
+                        const double output = outputs[p * layerSize + to];
+                        gradients[(from + 1) * layerSize + to] += value * (output * (1.0 - output)) * delta;
+                    }
+                }
+            }
+        }
+        
+        if (layer == 0)
+        {
+            break;
+        }
+        
+        /* Delta of perceptron of the previous layer, computed with weights before the update */
+        vector<double> previousDeltas(n * numOfLayerInputs);
+        for (int p = 0; p < n; p++)
+        {
+            for (int from = 0; from < numOfLayerInputs; from++)
+            {
+                double delta = 0;
+                for (int to = 0; to < layerSize; to++)
+                {
+                    delta += deltas[p * layerSize + to] * weights[(from + 1) * layerSize + to];
+                }
+                previousDeltas[p * numOfLayerInputs + from] = delta;
+            }
+        }
+        deltas = move(previousDeltas);
+        
+        /* Outputs of this layer are not needed anymore */
+        vector<double>().swap(values[k + 1]);
+    }
+    
+    if (s > 0)
+    {
+        message.values = move(deltas);
+        _stages[s - 1]->backwardQueue.push(move(message));
+    }
+    else
+    {
+        message.values.clear();
+        _completionQueue->push(move(message));
+    }
+}
+
+void PipelinedTrainer::update(const int s, const Message& message)
+{
+    Stage& stage = *_stages[s];
+    for (int k = 0; k < stage.weights.size(); k++)
+    {
+        vector<double>& weights = stage.weights[k];
+        vector<double>& gradients = stage.gradients[k];
+        for (int i = 0; i < weights.size(); i++)
+        {
+            weights[i] = weights[i] - (gradients[i] / message.numOfPatterns) * message.stepSize;
+            gradients[i] = 0;
+        }
+    }
+}
+
+void PipelinedTrainer::train(NeuralNetwork& network,
+                             const vector<pair<vector<double>, double>>& patterns,
+                             const int numOfEpochs,
+                             const double stepSize)
+{
+    for (int i = 0; i < patterns.size(); i++)
+    {
+        if (!network.isValidSampleOutput(patterns[i].second))
+        {
+            cerr << "Sample output of pattern " << i << " is not a class index" << endl;
+            return;
+        }
+    }
+    
+    _numOfInputs = network.getNumOfInputs();
+    _numsOfPerceptrons = network.getNumsOfPerceptrons();
+    _lossFunction = network.getLossFunction();
+    _hasSoftmaxOutput = network.hasSoftmaxOutput();
+    _patterns = &patterns;
+    
+    createStages(network.getWeights());
+    chooseStashedLayers();
+    const int maxNumOfMicroBatchesInFlight = (int)_stages.size();
+    
+    vector<thread> threads;
+    for (int s = 0; s < _stages.size(); s++)
+    {
+        threads.push_back(thread(&PipelinedTrainer::runStage, this, s));
+    }
+    
+    int microBatch = 0;
+    for (int i = 0; i < numOfEpochs; i++)
+    {
+        double error = 0;
+        for (int start = 0; start < patterns.size(); start += _miniBatchSize)
+        {
+            const int end = min((int)patterns.size(), start + _miniBatchSize);
+            
+            int numInFlight = 0;
+            for (int first = start; first < end; first += _microBatchSize)
+            {
+                if (numInFlight == maxNumOfMicroBatchesInFlight)
+                {
+                    error += _completionQueue->pop().error;
+                    numInFlight--;
+                }
+                
+                _stages[0]->forwardQueue.push({FORWARD, microBatch++, first, min(_microBatchSize, end - first), 0, 0, {}});
+                numInFlight++;
+            }
+            
+            /* Flush of the pipeline, then all stages update their weights */
+            for (; numInFlight > 0; numInFlight--)
+            {
+                error += _completionQueue->pop().error;
+            }
+            _stages[0]->forwardQueue.push({UPDATE, -1, start, end - start, 0, stepSize, {}});
+        }
+        if (_printProgress)
+        {
+            cout << i << ": " << error / patterns.size() << endl;
+        }
+    }
+    
+    _stages[0]->forwardQueue.push({STOP, -1, 0, 0, 0, 0, {}});
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    
+    vector<double> weights;
+    for (const auto& stage : _stages)
+    {
+        for (const auto& layerWeights : stage->weights)
+        {
+            weights.insert(weights.end(), layerWeights.begin(), layerWeights.end());
+        }
+    }
+    network.setWeights(weights);
+    
+    _stages.clear();
+    _patterns = nullptr;
+}
+
+}
@@ -0,0 +1,169 @@
+#pragma  once
+
+#include "NeuralNetwork.h"
+#include "SpscQueue.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Pipeline-parallel training of deep networks.
+ *
+ * Layers are split into contiguous groups (stages) with roughly the same number
+ * of weights, each stage runs on its own thread. Every mini-batch is split into
+ * micro-batches which stream through the stages forward and back, a stage always
+ * prefers backward work over forward (1F1B scheduling), so at most numOfStages
+ * micro-batches are in flight. Stages communicate via lock-free SPSC queues.
+ * Gradients are accumulated over the mini-batch and all stages update their
+ * weights at the end of it (synchronous flush, as in GPipe), hence the result
+ * is plain mini-batch gradient descent. With miniBatchSize == 1 it performs
+ * the same updates as NeuralNetwork::train.
+ *
+ * Activations needed by backward pass are stashed per micro-batch. To bound the memory
+ * of deep networks with large micro-batches, only outputs of selected layers can be stashed
+ * (gradient checkpointing), the others are recomputed from the nearest stashed layer
+ * during backward pass. Recomputation gives identical values, so results do not change.
+ */
+class PipelinedTrainer
+{
+private:
+    enum MessageType
+    {
+        FORWARD = 0,
+        BACKWARD = 1,
+        UPDATE = 2,
+        STOP = 3
+    };
+    
+    struct Message
+    {
+        MessageType type;
+        int microBatch;
+        int firstPattern;
+        int numOfPatterns;
+        double error; // sum of errors of the micro-batch (on the way back)
+        double stepSize; // for UPDATE
+        std::vector<double> values; // outputs (forward) or deltas (backward) of the boundary layer, per pattern
+    };
+    
+    struct Stage
+    {
+        int firstLayer;
+        int lastLayer;
+        
+        /* Per layer of the stage, indexed by (from + 1) * layerSize + to, from == -1 is bias */
+        std::vector<std::vector<double>> weights;
+        std::vector<std::vector<double>> gradients;
+        
+        /* Per micro-batch in flight: stage input and outputs of its layers, per pattern */
+        std::map<int, std::vector<std::vector<double>>> stash;
+        
+        SpscQueue<Message> forwardQueue;
+        SpscQueue<Message> backwardQueue;
+        
+        Stage(const size_t capacity) : forwardQueue(capacity), backwardQueue(capacity) {}
+    };
+    
+    const int _numOfStages;
+    const int _miniBatchSize;
+    const int _microBatchSize;
+    bool _printProgress;
+    
+    /* Set for the duration of train */
+    int _numOfInputs;
+    std::vector<int> _numsOfPerceptrons;
+    LossFunction _lossFunction;
+    bool _hasSoftmaxOutput;
+    const std::vector<std::pair<std::vector<double>, double>>* _patterns;
+    
+    /* Gradient checkpointing */
+    std::vector<int> _stashedLayers;
+    bool _stashAllLayers;
+    size_t _activationMemoryBudget; // in bytes, 0 means no budget
+    std::vector<bool> _isLayerStashed; // resolved for the duration of train
+    
+    std::vector<std::unique_ptr<Stage>> _stages;
+    std::unique_ptr<SpscQueue<Message>> _completionQueue; // finished micro-batches leaving stage 0
+    
+    int getNumOfLayerInputs(const int layer) {
+        return layer == 0 ? _numOfInputs : _numsOfPerceptrons[layer - 1];
+    }
+    
+    /**
+     * Splits layers to stages with roughly the same number of weights.
+     */
+    void createStages(const std::vector<double>& weights);
+    
+    /**
+     * Resolves which layers are stashed, either given explicitly or chosen to fit the memory budget.
+     */
+    void chooseStashedLayers();
+    
+    void runStage(const int s);
+    
+    /**
+     * Computes outputs of the layer for n patterns
+     * (and weighted sums if it is the output layer).
+     */
+    void computeLayer(const Stage& stage, const int layer, const int n,
+                      const std::vector<double>& inputs, std::vector<double>& outputs,
+                      std::vector<double>& weightedSums);
+    
+    /**
+     * Makes values[k] (stashed values of micro-batch in stage) available, recomputing them if needed.
+     */
+    void restoreValues(const Stage& stage, const int n, std::vector<std::vector<double>>& values, const int k);
+    
+    /**
+     * Computes outputs of stage layers and stashes them.
+     * For the last stage also computes loss and output deltas and continues backward.
+     */
+    void forward(const int s, Message& message);
+    
+    /**
+     * Given deltas of the last layer of the stage, accumulates gradients
+     * and sends deltas of the previous layer to the previous stage.
+     */
+    void backward(const int s, Message& message);
+    
+    void update(const int s, const Message& message);
+    
+public:
+    PipelinedTrainer(const int numOfStages,
+                     const int miniBatchSize = 32,
+                     const int microBatchSize = 4);
+    
+    /**
+     * Turns printing of error after each epoch on (default) or off.
+     */
+    void setPrintProgress(const bool printProgress) { _printProgress = printProgress; }
+    
+    /**
+     * Keeps only outputs of given layers (and inputs of stages) between forward
+     * and backward pass, the other layers are recomputed. All layers are stashed by default.
+     */
+    void setStashedLayers(const std::vector<int>& layers);
+    
+    /**
+     * Chooses stashed layers automatically (as evenly spaced as possible),
+     * so that activations stashed by the whole pipeline fit into given number of bytes.
+     * 0 turns it off.
+     */
+    void setActivationMemoryBudget(const size_t bytes);
+    
+    /**
+     * Trains weights currently set in the network (initialize them first,
+     * e.g. by NeuralNetwork::initializeWeights) and writes the result back.
+     * Nothing is trained if any sample output is not valid (see NeuralNetwork::isValidSampleOutput).
+     */
+    void train(NeuralNetwork& network,
+               const std::vector<std::pair<std::vector<double>, double>>& patterns,
+               const int numOfEpochs,
+               const double stepSize);
+};
+
+}
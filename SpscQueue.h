@@ -0,0 +1,90 @@
+#pragma  once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * Indices are kept in separate cache lines by explicit padding rather than alignas,
+ * as over-aligned types allocated by new are not aligned before C++17.
+ */
+template<typename T>
+class SpscQueue
+{
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+    
+    std::vector<T> _buffer; // one slot is always left empty to distinguish full from empty
+    
+    char _headPadding[CACHE_LINE_SIZE];
+    std::atomic<size_t> _head; // next slot to pop, written by consumer only
+    char _tailPadding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail; // next slot to push, written by producer only
+    char _endPadding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    
+public:
+    explicit SpscQueue(const size_t capacity) :
+        _buffer(capacity + 1),
+        _head(0),
+        _tail(0)
+    {
+    }
+    
+    /**
+     * Returns false (and leaves value untouched) if the queue is full.
+     */
+    bool tryPush(T& value)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) % _buffer.size();
+        if (next == _head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        
+        _buffer[tail] = std::move(value);
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+    
+    /**
+     * Returns false if the queue is empty.
+     */
+    bool tryPop(T& value)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        
+        value = std::move(_buffer[head]);
+        _head.store((head + 1) % _buffer.size(), std::memory_order_release);
+        return true;
+    }
+    
+    void push(T value)
+    {
+        while (!tryPush(value))
+        {
+            std::this_thread::yield();
+        }
+    }
+    
+    T pop()
+    {
+        T value;
+        while (!tryPop(value))
+        {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+};
+
+}
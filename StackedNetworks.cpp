@@ -0,0 +1,225 @@
+#include "StackedNetworks.h"
+#include "Activation.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace NeNet
+{
+
+StackedNetworks::StackedNetworks(const int numOfInputs,
+                                 const vector<int>& numsOfPerceptrons,
+                                 const int numOfNetworks) :
+    _numOfInputs(numOfInputs),
+    _numOfLayers((int)numsOfPerceptrons.size()),
+    _numsOfPerceptrons(numsOfPerceptrons),
+    _numOfNetworks(numOfNetworks),
+    _stepSizes(numOfNetworks, 0),
+    _values(numOfNetworks, 0)
+{
+    for (int layer = 0; layer < _numOfLayers; layer++)
+    {
+        const int layerSize = _numsOfPerceptrons[layer];
+        _weights.push_back(vector<double>((getNumOfLayerInputs(layer) + 1) * layerSize * _numOfNetworks, 1));
+        _weightedSums.push_back(vector<double>(layerSize * _numOfNetworks, 0));
+        _outputs.push_back(vector<double>(layerSize * _numOfNetworks, 0));
+        _deltas.push_back(vector<double>(layerSize * _numOfNetworks, 0));
+    }
+}
+
+void StackedNetworks::setWeights(const int network, const vector<double>& weights)
+{
+    /* Edges of NeuralNetwork are ordered by layer, then by origin, then by destination */
+    int edge = 0;
+    for (auto& layerWeights : _weights)
+    {
+        for (int i = 0; i < layerWeights.size() / _numOfNetworks; i++)
+        {
+            layerWeights[i * _numOfNetworks + network] = weights[edge++];
+        }
+    }
+}
+
+vector<double> StackedNetworks::getWeights(const int network)
+{
+    vector<double> weights;
+    for (const auto& layerWeights : _weights)
+    {
+        for (int i = 0; i < layerWeights.size() / _numOfNetworks; i++)
+        {
+            weights.push_back(layerWeights[i * _numOfNetworks + network]);
+        }
+    }
+    return weights;
+}
+
+void StackedNetworks::forwardPropagate(const vector<double>& input)
+{
+    const int n = _numOfNetworks;
+    for (int layer = 0; layer < _numOfLayers; layer++)
+    {
+        const int layerSize = _numsOfPerceptrons[layer];
+        const int numOfLayerInputs = getNumOfLayerInputs(layer);
+        const double* weights = _weights[layer].data();
+        const double* previousOutputs = layer == 0 ? nullptr : _outputs[layer - 1].data();
+        double* weightedSums = _weightedSums[layer].data();
+        double* outputs = _outputs[layer].data();
+        
+        for (int to = 0; to < layerSize; to++)
+        {
+            double* sums = weightedSums + to * n;
+            const double* biases = weights + to * n;
+            for (int k = 0; k < n; k++)
+            {
+                sums[k] = 0;
+                sums[k] += 1.0 * biases[k];
+            }
+            
+            for (int from = 0; from < numOfLayerInputs; from++)
+            {
+                const double* edgeWeights = weights + ((from + 1) * layerSize + to) * n;
+                if (layer == 0)
+                {
+                    /* Input is shared by all networks */
+                    const double value = input[from];
+                    for (int k = 0; k < n; k++)
+                    {
+                        sums[k] += value * edgeWeights[k];
+                    }
+                }
+                else
+                {
+                    const double* values = previousOutputs + from * n;
+                    for (int k = 0; k < n; k++)
+                    {
+                        sums[k] += values[k] * edgeWeights[k];
+                    }
+                }
+            }
+            
+            for (int k = 0; k < n; k++)
+            {
+                outputs[to * n + k] = sigmoid(sums[k]);
+            }
+        }
+    }
+}
+
+void StackedNetworks::backwardPropagate(const double sampleOutput)
+{
+    const int n = _numOfNetworks;
+    
+    /* Deltas (computed with weights before the update, same as Perceptron::calculateDelta) */
+    const int outputLayer = _numOfLayers - 1;
+    for (int i = 0; i < _numsOfPerceptrons[outputLayer] * n; i++)
+    {
+        const double output = _outputs[outputLayer][i];
+        _deltas[outputLayer][i] = 2 * (output - sampleOutput) * (output * (1.0 - output));
+    }
+    
+    for (int layer = outputLayer - 1; layer >= 0; layer--)
+    {
+        const int layerSize = _numsOfPerceptrons[layer];
+        const int nextLayerSize = _numsOfPerceptrons[layer + 1];
+        const double* nextWeights = _weights[layer + 1].data();
+        const double* nextDeltas = _deltas[layer + 1].data();
+        
+        for (int from = 0; from < layerSize; from++)
+        {
+            double* deltas = _deltas[layer].data() + from * n;
+            for (int k = 0; k < n; k++)
+            {
+                deltas[k] = 0;
+            }
+            for (int to = 0; to < nextLayerSize; to++)
+            {
+                const double* edgeWeights = nextWeights + ((from + 1) * nextLayerSize + to) * n;
+                const double* successorDeltas = nextDeltas + to * n;
+                for (int k = 0; k < n; k++)
+                {
+                    deltas[k] += successorDeltas[k] * edgeWeights[k];
+                }
+            }
+        }
+    }
+}
+
+void StackedNetworks::trainOnPattern(const vector<double>& input, const double output, vector<double>& errors)
+{
+    const int n = _numOfNetworks;
+    
+    forwardPropagate(input);
+    
+    const double* networkOutputs = _outputs[_numOfLayers - 1].data();
+    for (int k = 0; k < n; k++)
+    {
+        errors[k] += pow(networkOutputs[k] - output, 2);
+    }
+    
+    backwardPropagate(output);
+    
+    /* Updating weights: error of edge is value * delta for output layer
+     * and value * derivative of activation * delta for others */
+    const double* stepSizes = _stepSizes.data();
+    for (int layer = 0; layer < _numOfLayers; layer++)
+    {
+        const bool isOutputLayer = layer == _numOfLayers - 1;
+        const int layerSize = _numsOfPerceptrons[layer];
+        const int numOfLayerInputs = getNumOfLayerInputs(layer);
+        double* weights = _weights[layer].data();
+        const double* outputs = _outputs[layer].data();
+        const double* deltas = _deltas[layer].data();
+        
+        for (int from = -1; from < numOfLayerInputs; from++)
+        {
+            /* Values on the edges going from perceptron "from" */
+            double* values = _values.data();
+            for (int k = 0; k < n; k++)
+            {
+                if (from == -1) {
+                    values[k] = 1;
+                } else if (layer == 0) {
+                    values[k] = input[from];
+                } else {
+                    values[k] = _outputs[layer - 1][from * n + k];
+                }
+            }
+            
+            for (int to = 0; to < layerSize; to++)
+            {
+                double* edgeWeights = weights + ((from + 1) * layerSize + to) * n;
+                const double* toOutputs = outputs + to * n;
+                const double* toDeltas = deltas + to * n;
+                if (isOutputLayer)
+                {
+                    for (int k = 0; k < n; k++)
+                    {
+                        edgeWeights[k] = edgeWeights[k] - values[k] * toDeltas[k] * stepSizes[k];
+                    }
+                }
+                else
+                {
+                    for (int k = 0; k < n; k++)
+                    {
+                        const double error = values[k] * (toOutputs[k] * (1.0 - toOutputs[k])) * toDeltas[k];
+                        edgeWeights[k] = edgeWeights[k] - error * stepSizes[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void StackedNetworks::addErrors(const vector<double>& input, const double output, vector<double>& errors)
+{
+    forwardPropagate(input);
+    
+    const double* networkOutputs = _outputs[_numOfLayers - 1].data();
+    for (int k = 0; k < _numOfNetworks; k++)
+    {
+        errors[k] += pow(networkOutputs[k] - output, 2);
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma  once
+
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Several networks of the same topology trained in lockstep.
+ *
+ * Weights of all networks are interleaved, i.e. the weight of the same edge
+ * of all networks is stored contiguously, so each step of forward and backward
+ * propagation is a loop over networks which compiler can vectorize.
+ * Training performs exactly the same arithmetic as NeuralNetwork::train,
+ * so weights trained here can be loaded to NeuralNetwork via setWeights.
+ */
+class StackedNetworks
+{
+private:
+    const int _numOfInputs;
+    const int _numOfLayers;
+    const std::vector<int> _numsOfPerceptrons;
+    const int _numOfNetworks;
+    
+    /* Per layer, indexed by ((from + 1) * layerSize + to) * numOfNetworks + network, from == -1 is bias */
+    std::vector<std::vector<double>> _weights;
+    
+    /* Per layer, indexed by perceptron * numOfNetworks + network */
+    std::vector<std::vector<double>> _weightedSums;
+    std::vector<std::vector<double>> _outputs;
+    std::vector<std::vector<double>> _deltas;
+    
+    std::vector<double> _stepSizes;
+    std::vector<double> _values; // scratch buffer used in the update of weights
+    
+    int getNumOfLayerInputs(const int layer) {
+        return layer == 0 ? _numOfInputs : _numsOfPerceptrons[layer - 1];
+    }
+    
+    void forwardPropagate(const std::vector<double>& input);
+    
+    void backwardPropagate(const double sampleOutput);
+    
+public:
+    StackedNetworks(const int numOfInputs,
+                    const std::vector<int>& numsOfPerceptrons,
+                    const int numOfNetworks);
+    
+    int getNumOfNetworks() { return _numOfNetworks; }
+    
+    /**
+     * Sets/returns weights of given network, in order of NeuralNetwork::getEdges().
+     */
+    void setWeights(const int network, const std::vector<double>& weights);
+    std::vector<double> getWeights(const int network);
+    
+    double getStepSize(const int network) { return _stepSizes[network]; }
+    void setStepSize(const int network, const double stepSize) { _stepSizes[network] = stepSize; }
+    
+    /**
+     * One step of sequential training of all networks on given pattern.
+     * Adds squared error (before the update) of each network to errors.
+     */
+    void trainOnPattern(const std::vector<double>& input, const double output, std::vector<double>& errors);
+    
+    /**
+     * Adds squared error of each network on given pattern to errors.
+     */
+    void addErrors(const std::vector<double>& input, const double output, std::vector<double>& errors);
+};
+
+}
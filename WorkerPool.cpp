@@ -0,0 +1,134 @@
+#include "WorkerPool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace NeNet
+{
+
+static const int NUM_OF_SPINS_BEFORE_SLEEP = 1 << 14;
+
+/**
+ * Hint to the CPU that this is a spin-wait loop (saves power and
+ * frees resources of the core for its sibling hyper-thread).
+ */
+static inline void spinPause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+WorkerPool::WorkerPool(const int numOfThreads) :
+    _generation(0),
+    _numOfRunning(0),
+    _stop(false),
+    _numOfSleeping(0),
+    _job(nullptr),
+    _numOfItems(0)
+{
+    for (int worker = 1; worker < numOfThreads; worker++)
+    {
+        _threads.push_back(thread(&WorkerPool::work, this, worker));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    _stop.store(true);
+    {
+        lock_guard<mutex> lock(_mutex);
+        _wakeUp.notify_all();
+    }
+    for (auto& t : _threads)
+    {
+        t.join();
+    }
+}
+
+void WorkerPool::runPart(const int worker)
+{
+    const int numOfThreads = getNumOfThreads();
+    const int begin = (int)((long)_numOfItems * worker / numOfThreads);
+    const int end = (int)((long)_numOfItems * (worker + 1) / numOfThreads);
+    if (begin < end)
+    {
+        (*_job)(begin, end);
+    }
+}
+
+long WorkerPool::waitForJob(const long seenGeneration)
+{
+    for (int numOfSpins = 0; numOfSpins < NUM_OF_SPINS_BEFORE_SLEEP; numOfSpins++)
+    {
+        const long generation = _generation.load(memory_order_acquire);
+        if (generation != seenGeneration || _stop.load(memory_order_acquire))
+        {
+            return generation;
+        }
+        spinPause();
+    }
+    
+    /* Sleeping; run checks _numOfSleeping after publishing new generation
+     * and both are sequentially consistent, so the wake-up cannot be missed */
+    unique_lock<mutex> lock(_mutex);
+    _numOfSleeping++;
+    long generation;
+    while ((generation = _generation.load()) == seenGeneration && !_stop.load())
+    {
+        _wakeUp.wait(lock);
+    }
+    _numOfSleeping--;
+    return generation;
+}
+
+void WorkerPool::work(const int worker)
+{
+    long seenGeneration = 0;
+    while (true)
+    {
+        const long generation = waitForJob(seenGeneration);
+        if (generation == seenGeneration)
+        {
+            return;
+        }
+        seenGeneration = generation;
+        
+        runPart(worker);
+        _numOfRunning.fetch_sub(1, memory_order_release);
+    }
+}
+
+void WorkerPool::run(const int numOfItems, const function<void(int, int)>& job)
+{
+    _job = &job;
+    _numOfItems = numOfItems;
+    _numOfRunning.store((int)_threads.size(), memory_order_relaxed);
+    _generation.fetch_add(1);
+    if (_numOfSleeping.load() > 0)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _wakeUp.notify_all();
+    }
+    
+    runPart(0);
+    
+    /* Barrier: waiting for the other workers, yielding if they take long
+     * (e.g. were sleeping or the cores are oversubscribed) */
+    for (int numOfSpins = 0; _numOfRunning.load(memory_order_acquire) > 0; numOfSpins++)
+    {
+        if (numOfSpins < NUM_OF_SPINS_BEFORE_SLEEP) {
+            spinPause();
+        } else {
+            this_thread::yield();
+        }
+    }
+    _job = nullptr;
+}
+
+}
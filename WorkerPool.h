@@ -0,0 +1,70 @@
+#pragma  once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NeNet
+{
+
+/**
+ * Persistent pool of spin-waiting threads for splitting short jobs
+ * (e.g. one layer of a single forward propagation) with minimal latency.
+ *
+ * Workers busy-wait for the next job for a bounded number of spins,
+ * so back-to-back calls of run dispatch and finish well under a microsecond.
+ * After that they sleep on a condition variable and cost no CPU while the pool is idle.
+ */
+class WorkerPool
+{
+private:
+    std::vector<std::thread> _threads;
+    
+    std::atomic<long> _generation; // incremented by each call of run
+    std::atomic<int> _numOfRunning; // workers which have not finished current job yet
+    std::atomic<bool> _stop;
+    
+    /* Parking of idle workers */
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::atomic<int> _numOfSleeping;
+    
+    /* Current job, valid while its generation lasts */
+    const std::function<void(int, int)>* _job;
+    int _numOfItems;
+    
+    void work(const int worker);
+    
+    /**
+     * Waits until generation differs from the seen one or the pool stops,
+     * returns the new generation (or the seen one when stopping).
+     */
+    long waitForJob(const long seenGeneration);
+    
+    /**
+     * Runs part of the current job belonging to given worker (0 is the caller of run).
+     */
+    void runPart(const int worker);
+    
+public:
+    /**
+     * numOfThreads includes the thread calling run.
+     */
+    explicit WorkerPool(const int numOfThreads);
+    
+    ~WorkerPool();
+    
+    int getNumOfThreads() { return (int)_threads.size() + 1; }
+    
+    /**
+     * Splits [0, numOfItems) into contiguous ranges, calls job(begin, end) for each
+     * of them in parallel and returns when all of them are finished.
+     * Must not be called concurrently.
+     */
+    void run(const int numOfItems, const std::function<void(int, int)>& job);
+};
+
+}